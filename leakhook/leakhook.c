@@ -1,21 +1,53 @@
-// leakhook.c  (gcc -shared -fPIC -ldl -pthread -o libleakhook.so leakhook.c)
+// leakhook.c  (gcc -shared -fPIC -fexceptions -ldl -pthread -o libleakhook.so leakhook.c)
 // 可选：-lunwind 或 -lexecinfo 以开启回溯
+// C++ 进程：-fexceptions 让 operator new 的 bad_alloc 能穿过本层 hook
+// kill -USR1 <pid>：打印在存块；调用 leakhook_leak_check()：可达性扫描，区分泄漏与常驻块
+// LEAKHOOK_LEAK_CHECK=1 时另起后台线程，kill -USR2 <pid> 即可触发扫描（默认不占 SIGUSR2、不起线程）
+// 扫描线程数：LEAKHOOK_SCAN_THREADS（默认 CPU 数，最多 8）
+// 自动快照：设置 LEAKHOOK_WD_BYTES / LEAKHOOK_WD_RATE / LEAKHOOK_WD_HWM_PCT 任一即启用看门狗，见文件末尾
 #define _GNU_SOURCE
+#include <dirent.h>
 #include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdatomic.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <execinfo.h>   // 若musl无此头，可改用 libunwind
 #include <unistd.h>
 
+/* 分配来源（报告里区分，并用于 new/delete 与 free 的错配检查） */
+enum { K_MALLOC, K_CALLOC, K_REALLOC, K_MEMALIGN, K_NEW, K_NEW_ARR, K_MMAP };
+static const char* kind_name(int k){
+    switch(k){
+        case K_MALLOC:   return "malloc";
+        case K_CALLOC:   return "calloc";
+        case K_REALLOC:  return "realloc";
+        case K_MEMALIGN: return "memalign";
+        case K_NEW:      return "new";
+        case K_NEW_ARR:  return "new[]";
+        case K_MMAP:     return "mmap";
+        default:         return "?";
+    }
+}
+
 typedef struct Node {
     void* ptr;
     size_t size;
+    size_t usable;  // malloc_usable_size，对齐/分箱后的真实占用
     uint64_t tid;
     uint32_t hash;
+    uint8_t kind;
     int bt_n;
     void* bt[16];   // 调用栈（可调小以省内存）
     struct Node* next;
@@ -25,92 +57,1267 @@ static void* (*real_malloc)(size_t)=NULL;
 static void  (*real_free)(void*)=NULL;
 static void* (*real_calloc)(size_t,size_t)=NULL;
 static void* (*real_realloc)(void*,size_t)=NULL;
+static int   (*real_posix_memalign)(void**,size_t,size_t)=NULL;
+static void* (*real_aligned_alloc)(size_t,size_t)=NULL;
+static void* (*real_memalign)(size_t,size_t)=NULL;
+static void* (*real_valloc)(size_t)=NULL;
+static void* (*real_pvalloc)(size_t)=NULL;
+static size_t(*real_usable_size)(void*)=NULL;
+static void* (*real_mmap)(void*,size_t,int,int,int,off_t)=NULL;
+static void* (*real_mmap64)(void*,size_t,int,int,int,off64_t)=NULL;
+static int   (*real_munmap)(void*,size_t)=NULL;
+static void* (*real_mremap)(void*,size_t,size_t,int,...)=NULL;
 
 #define HSIZE  65536   // 哈希桶
 static Node* g_tab[HSIZE];
 static pthread_mutex_t g_mu[HSIZE];
 static atomic_size_t g_inuse = 0;
+static atomic_size_t g_usable = 0;
+static atomic_size_t g_mismatch = 0;   // new/delete[]/free 配对错误次数
+
+/* 本线程正处于 hook 内部（回溯/报告会再次进入 malloc），此时不记录 */
+static __thread int t_in_hook __attribute__((tls_model("initial-exec")));
 
 static inline uint32_t h32(uint64_t x){ x^=x>>33; x*=0xff51afd7ed558ccdULL; x^=x>>33; x*=0xc4ceb9fe1a85ec53ULL; x^=x>>33; return (uint32_t)x; }
 static inline uint64_t get_tid(){ return (uint64_t)pthread_self(); }
 
+/* ---- 自举分配器：dlsym 内部会 calloc/malloc，real_* 就绪前从静态区分配 ---- */
+#define BOOT_SIZE  (64*1024)
+static char g_boot[BOOT_SIZE] __attribute__((aligned(64)));
+static atomic_size_t g_boot_off = 0;
+
+static void* boot_alloc(size_t sz, size_t align){
+    if(align < 16) align = 16;
+    size_t need = (sz + 15) & ~(size_t)15;
+    for(;;){
+        size_t off = atomic_load(&g_boot_off);
+        size_t p = (off + 16 + align - 1) & ~(align - 1);   // 前 16B 存 size
+        if(p + need > BOOT_SIZE) return NULL;
+        if(atomic_compare_exchange_weak(&g_boot_off, &off, p + need)){
+            *(size_t*)(g_boot + p - 16) = sz;
+            return g_boot + p;                           // 静态区本就是零
+        }
+    }
+}
+static inline int is_boot(const void* p){ return (const char*)p >= g_boot && (const char*)p < g_boot + BOOT_SIZE; }
+static inline size_t boot_size(const void* p){ return *(const size_t*)((const char*)p - 16); }
+
+/* 0=未初始化 1=初始化中 2=就绪 */
+static atomic_int g_state = 0;
+static __thread int t_initing __attribute__((tls_model("initial-exec")));
+
 static __attribute__((constructor)) void init_hook(){
+    int expect = 0;
+    if(!atomic_compare_exchange_strong(&g_state, &expect, 1)) return;
+    t_initing = 1;
     real_malloc  = dlsym(RTLD_NEXT,"malloc");
     real_free    = dlsym(RTLD_NEXT,"free");
     real_calloc  = dlsym(RTLD_NEXT,"calloc");
     real_realloc = dlsym(RTLD_NEXT,"realloc");
+    real_posix_memalign = dlsym(RTLD_NEXT,"posix_memalign");
+    real_aligned_alloc  = dlsym(RTLD_NEXT,"aligned_alloc");
+    real_memalign       = dlsym(RTLD_NEXT,"memalign");
+    real_valloc         = dlsym(RTLD_NEXT,"valloc");
+    real_pvalloc        = dlsym(RTLD_NEXT,"pvalloc");
+    real_usable_size    = dlsym(RTLD_NEXT,"malloc_usable_size");
+    real_mmap    = dlsym(RTLD_NEXT,"mmap");
+    real_mmap64  = dlsym(RTLD_NEXT,"mmap64");
+    real_munmap  = dlsym(RTLD_NEXT,"munmap");
+    real_mremap  = dlsym(RTLD_NEXT,"mremap");
     for(int i=0;i<HSIZE;++i) pthread_mutex_init(&g_mu[i], NULL);
+    t_initing = 0;
+    atomic_store(&g_state, 2);
 }
 
-static void record_alloc(void* p, size_t sz){
-    if(!p) return;
+/* 返回 0 表示 real_* 尚不可用（本线程正在 init_hook 里），调用方走自举分配 */
+static inline int hook_ready(){
+    if(atomic_load_explicit(&g_state, memory_order_acquire) == 2) return 1;
+    if(t_initing) return 0;
+    init_hook();
+    while(atomic_load(&g_state) != 2) sched_yield();   // 别的线程正在初始化
+    return 1;
+}
+
+static void record_alloc(void* p, size_t sz, int kind){
+    if(!p || t_in_hook) return;
+    t_in_hook = 1;
     Node* n = real_malloc(sizeof(Node));
-    if(!n) return;
-    n->ptr=p; n->size=sz; n->tid=get_tid();
+    if(!n){ t_in_hook = 0; return; }
+    n->ptr=p; n->size=sz; n->tid=get_tid(); n->kind=(uint8_t)kind;
+    n->usable = real_usable_size ? real_usable_size(p) : sz;
     n->bt_n = backtrace(n->bt, 16); // 若不可用，可置0
     uint32_t k = h32((uint64_t)p);
     n->hash=k; int b = k & (HSIZE-1);
     pthread_mutex_lock(&g_mu[b]);
-    n->next = g_tab[b]; g_tab[b]=n;
+    n->next = g_tab[b]; __atomic_store_n(&g_tab[b], n, __ATOMIC_RELAXED);   // 桶头可被看门狗无锁预读
     pthread_mutex_unlock(&g_mu[b]);
     atomic_fetch_add(&g_inuse, sz);
+    atomic_fetch_add(&g_usable, n->usable);
+    t_in_hook = 0;
 }
 
-static void record_free(void* p){
-    if(!p) return;
+/* 释放方式分组：0=free 1=delete 2=delete[]；返回原 size（未找到为 0），kind 回填 */
+static int free_group(int kind){ return kind==K_NEW ? 1 : kind==K_NEW_ARR ? 2 : 0; }
+
+static size_t record_free(void* p, int group, int* out_kind){
+    if(!p || t_in_hook) return 0;
     uint32_t k = h32((uint64_t)p);
     int b = k & (HSIZE-1);
     pthread_mutex_lock(&g_mu[b]);
     Node** pp = &g_tab[b];
     while(*pp){
         if((*pp)->ptr==p){
-            Node* del=*pp; *pp=del->next;
+            Node* del=*pp; __atomic_store_n(pp, del->next, __ATOMIC_RELAXED);
             atomic_fetch_sub(&g_inuse, del->size);
+            atomic_fetch_sub(&g_usable, del->usable);
             pthread_mutex_unlock(&g_mu[b]);
+            size_t sz = del->size;
+            if(out_kind) *out_kind = del->kind;
+            if(group >= 0 && free_group(del->kind) != group) atomic_fetch_add(&g_mismatch, 1);
             real_free(del);
-            return;
+            return sz;
         }
         pp=&(*pp)->next;
     }
     pthread_mutex_unlock(&g_mu[b]);
     // double free / 外部释放，不处理
+    return 0;
 }
 
-void* malloc(size_t sz){ void* p = real_malloc(sz); record_alloc(p, sz); return p; }
-void  free(void* p){ record_free(p); real_free(p); }
-void* calloc(size_t n,size_t s){ void* p=real_calloc(n,s); record_alloc(p, n*s); return p; }
+void* malloc(size_t sz){
+    if(!hook_ready()) return boot_alloc(sz, 16);
+    void* p = real_malloc(sz); record_alloc(p, sz, K_MALLOC); return p;
+}
+void  free(void* p){
+    if(!p || is_boot(p) || !hook_ready()) return;
+    record_free(p, 0, NULL); real_free(p);
+}
+void* calloc(size_t n,size_t s){
+    if(!hook_ready()){
+        size_t t;
+        if(__builtin_mul_overflow(n, s, &t)) return NULL;
+        return boot_alloc(t, 16);
+    }
+    void* p=real_calloc(n,s); record_alloc(p, n*s, K_CALLOC); return p;
+}
 void* realloc(void* p,size_t s){
-    if(p) record_free(p);
+    if(is_boot(p) || !hook_ready()){
+        void* np = malloc(s);   // 未就绪时 malloc 自己走自举区
+        if(np && p){ size_t o = boot_size(p); memcpy(np, p, o < s ? o : s); }
+        return np;
+    }
+    int kind = -1;                                // 旧块在表里时回填原来源
+    size_t old = p ? record_free(p, -1, &kind) : 0;
     void* np = real_realloc(p,s);
-    record_alloc(np, s);
+    if(np) record_alloc(np, s, K_REALLOC);
+    else if(p && s && kind >= 0) record_alloc(p, old, kind);   // 失败时旧块仍有效，放回（未跟踪的不补记）
     return np;
 }
+void* reallocarray(void* p, size_t n, size_t s){
+    size_t t;
+    if(__builtin_mul_overflow(n, s, &t)){ errno = ENOMEM; return NULL; }
+    return realloc(p, t);
+}
+
+int posix_memalign(void** out, size_t align, size_t sz){
+    if(!hook_ready()){
+        void* p = boot_alloc(sz, align);
+        if(!p) return ENOMEM;
+        *out = p; return 0;
+    }
+    int rc = real_posix_memalign(out, align, sz);
+    if(rc == 0) record_alloc(*out, sz, K_MEMALIGN);
+    return rc;
+}
+void* aligned_alloc(size_t align, size_t sz){
+    if(!hook_ready()) return boot_alloc(sz, align);
+    void* p = real_aligned_alloc(align, sz); record_alloc(p, sz, K_MEMALIGN); return p;
+}
+void* memalign(size_t align, size_t sz){
+    if(!hook_ready()) return boot_alloc(sz, align);
+    void* p = real_memalign(align, sz); record_alloc(p, sz, K_MEMALIGN); return p;
+}
+void* valloc(size_t sz){
+    if(!hook_ready()) return boot_alloc(sz, 4096);
+    void* p = real_valloc(sz); record_alloc(p, sz, K_MEMALIGN); return p;
+}
+void* pvalloc(size_t sz){
+    if(!hook_ready()) return boot_alloc((sz + 4095) & ~(size_t)4095, 4096);
+    void* p = real_pvalloc(sz); record_alloc(p, sz, K_MEMALIGN); return p;
+}
+size_t malloc_usable_size(void* p){
+    if(!p) return 0;
+    if(is_boot(p)) return boot_size(p);
+    return real_usable_size ? real_usable_size(p) : 0;
+}
+
+/* ---- mmap 区间：按地址区间的区间树（treap，按 start 有序，节点维护子树 max_end） ----
+ * 与堆表分开：大块按页映射，munmap/mremap 可只截掉一段，需要按区间求交。 */
+typedef struct MapNode {
+    uintptr_t start, end, max_end;
+    uint32_t prio;
+    int prot, flags, fd;
+    uint64_t tid;
+    int bt_n;
+    void* bt[16];
+    struct MapNode *l, *r;
+} MapNode;
+
+static MapNode* g_maps = NULL;
+static pthread_mutex_t g_maps_mu = PTHREAD_MUTEX_INITIALIZER;
+static atomic_size_t g_mmap_inuse = 0;
+static size_t g_mmap_regions = 0;     // g_maps_mu 保护
+
+static inline uintptr_t mx(uintptr_t a, uintptr_t b){ return a > b ? a : b; }
+static void it_pull(MapNode* n){
+    n->max_end = n->end;
+    if(n->l) n->max_end = mx(n->max_end, n->l->max_end);
+    if(n->r) n->max_end = mx(n->max_end, n->r->max_end);
+}
+/* l: start < key, r: start >= key */
+static void it_split(MapNode* t, uintptr_t key, MapNode** l, MapNode** r){
+    if(!t){ *l = *r = NULL; return; }
+    if(t->start < key){ it_split(t->r, key, &t->r, r); *l = t; }
+    else              { it_split(t->l, key, l, &t->l); *r = t; }
+    it_pull(t);
+}
+static MapNode* it_merge(MapNode* a, MapNode* b){
+    if(!a) return b;
+    if(!b) return a;
+    if(a->prio > b->prio){ a->r = it_merge(a->r, b); it_pull(a); return a; }
+    b->l = it_merge(a, b->l); it_pull(b); return b;
+}
+static void it_insert(MapNode* n){
+    MapNode *l, *r;
+    n->l = n->r = NULL; n->max_end = n->end;
+    n->prio = h32((uint64_t)n->start);
+    it_split(g_maps, n->start, &l, &r);
+    g_maps = it_merge(it_merge(l, n), r);
+    g_mmap_regions++;
+}
+static void it_erase(MapNode* n){
+    MapNode *l, *m, *r;
+    it_split(g_maps, n->start, &l, &m);
+    it_split(m, n->start + 1, &m, &r);
+    g_maps = it_merge(l, r);
+    g_mmap_regions--;
+}
+/* 任取一个与 [lo,hi) 相交的区间：左子树 max_end > lo 而其中无交，则右侧也不会有 */
+static MapNode* it_overlap(MapNode* t, uintptr_t lo, uintptr_t hi){
+    while(t && !(t->start < hi && t->end > lo))
+        t = (t->l && t->l->max_end > lo) ? t->l : t->r;
+    return t;
+}
+
+/* 去掉 [lo,hi) 覆盖的部分，两端残留的区间保留原回溯；tmpl 非空时回填第一个被截区间的信息。
+ * saved 非空时，被截掉的那几段（带原属性）串在 ->l 上交给调用者，系统调用失败时用 maps_restore 放回 */
+static void maps_cut(uintptr_t lo, uintptr_t hi, MapNode* tmpl, MapNode** saved){
+    MapNode* n;
+    int first = 1;
+    while((n = it_overlap(g_maps, lo, hi))){
+        it_erase(n);
+        uintptr_t s = n->start, e = n->end;
+        uintptr_t cs = s > lo ? s : lo, ce = e < hi ? e : hi;
+        atomic_fetch_sub(&g_mmap_inuse, (size_t)(ce - cs));
+        if(tmpl && first){ *tmpl = *n; first = 0; }
+        int head = s < lo, tail = e > hi;
+        MapNode* c = (head || tail) ? (saved ? real_malloc(sizeof(MapNode)) : NULL) : n;
+        if(c && c != n) *c = *n;
+        if(head){ n->end = lo; it_insert(n); }
+        if(tail){
+            MapNode* t = head ? real_malloc(sizeof(MapNode)) : n;
+            if(t){ if(head) *t = *n; t->start = hi; t->end = e; it_insert(t); }
+        }
+        if(!c) continue;
+        if(saved){ c->start = cs; c->end = ce; c->l = *saved; *saved = c; }
+        else real_free(c);
+    }
+}
+static void maps_restore(MapNode* saved){
+    while(saved){
+        MapNode* nx = saved->l;
+        it_insert(saved);
+        atomic_fetch_add(&g_mmap_inuse, (size_t)(saved->end - saved->start));
+        saved = nx;
+    }
+}
+static void maps_drop(MapNode* saved){
+    while(saved){ MapNode* nx = saved->l; real_free(saved); saved = nx; }
+}
+
+static void record_map(void* p, size_t len, int prot, int flags, int fd){
+    if(p == MAP_FAILED || !len || t_in_hook) return;
+    t_in_hook = 1;
+    MapNode* n = real_malloc(sizeof(MapNode));
+    if(n){
+        uintptr_t s = (uintptr_t)p, e = s + ((len + 4095) & ~(size_t)4095);
+        n->start = s; n->end = e;
+        n->prot = prot; n->flags = flags; n->fd = fd; n->tid = get_tid();
+        n->bt_n = backtrace(n->bt, 16);
+        pthread_mutex_lock(&g_maps_mu);
+        maps_cut(s, e, NULL, NULL);           // MAP_FIXED 覆盖旧映射
+        it_insert(n);
+        atomic_fetch_add(&g_mmap_inuse, (size_t)(e - s));
+        pthread_mutex_unlock(&g_maps_mu);
+    }
+    t_in_hook = 0;
+}
+
+static void* sys_mmap(void* a, size_t len, int prot, int flags, int fd, off_t off){
+#ifdef SYS_mmap2
+    return (void*)syscall(SYS_mmap2, a, len, prot, flags, fd, (long)(off >> 12));
+#else
+    return (void*)syscall(SYS_mmap, a, len, prot, flags, fd, off);
+#endif
+}
+
+void* mmap(void* a, size_t len, int prot, int flags, int fd, off_t off){
+    if(!hook_ready()) return sys_mmap(a, len, prot, flags, fd, off);
+    void* p = real_mmap(a, len, prot, flags, fd, off);
+    record_map(p, len, prot, flags, fd);
+    return p;
+}
+void* mmap64(void* a, size_t len, int prot, int flags, int fd, off64_t off){
+    if(!hook_ready() || !real_mmap64) return sys_mmap(a, len, prot, flags, fd, (off_t)off);
+    void* p = real_mmap64(a, len, prot, flags, fd, off);
+    record_map(p, len, prot, flags, fd);
+    return p;
+}
+/* munmap/mremap：先在 g_maps_mu 下把区间从树上摘掉再做系统调用，失败时放回。
+ * 反过来的话，调用返回到摘除之间树上还挂着已解除的映射，并发的扫描/报告读它会 SIGSEGV。 */
+int munmap(void* a, size_t len){
+    if(!hook_ready()) return (int)syscall(SYS_munmap, a, len);
+    if(!len || t_in_hook) return real_munmap(a, len);
+    uintptr_t s = (uintptr_t)a, e = s + ((len + 4095) & ~(size_t)4095);
+    MapNode* saved = NULL;
+    pthread_mutex_lock(&g_maps_mu);
+    maps_cut(s, e, NULL, &saved);
+    int rc = real_munmap(a, len);
+    int err = errno;
+    if(rc != 0) maps_restore(saved);
+    pthread_mutex_unlock(&g_maps_mu);
+    if(rc == 0) maps_drop(saved);
+    errno = err;
+    return rc;
+}
+void* mremap(void* old, size_t old_len, size_t new_len, int flags, ...){
+    void* new_addr = NULL;
+    if(flags & MREMAP_FIXED){
+        va_list ap; va_start(ap, flags); new_addr = va_arg(ap, void*); va_end(ap);
+    }
+    if(!hook_ready()) return (void*)syscall(SYS_mremap, old, old_len, new_len, flags, new_addr);
+    if(t_in_hook) return real_mremap(old, old_len, new_len, flags, new_addr);
+    /* 旧区间的属性/回溯沿用到新区间 */
+    MapNode tmpl; memset(&tmpl, 0, sizeof(tmpl)); tmpl.fd = -1;
+    uintptr_t s = (uintptr_t)old, e = s + ((old_len + 4095) & ~(size_t)4095);
+    MapNode* saved = NULL;
+    MapNode* n = real_malloc(sizeof(MapNode));     // 锁外先备好新节点
+    pthread_mutex_lock(&g_maps_mu);
+    maps_cut(s, e, &tmpl, &saved);
+    void* p = real_mremap(old, old_len, new_len, flags, new_addr);
+    int err = errno;
+    if(p == MAP_FAILED) maps_restore(saved);
+    else if(tmpl.end && n){
+        *n = tmpl;
+        n->start = (uintptr_t)p; n->end = n->start + ((new_len + 4095) & ~(size_t)4095);
+        maps_cut(n->start, n->end, NULL, NULL);
+        it_insert(n);
+        atomic_fetch_add(&g_mmap_inuse, (size_t)(n->end - n->start));
+        n = NULL;
+    }
+    pthread_mutex_unlock(&g_maps_mu);
+    if(p != MAP_FAILED) maps_drop(saved);
+    if(n) real_free(n);
+    if(p != MAP_FAILED && !tmpl.end) record_map(p, new_len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1);
+    errno = err;
+    return p;
+}
+
+/* ---- C++ operator new/delete（含 sized / aligned / nothrow 变体）----
+ * 直接走 real_* 分配并按 new/new[] 记录；仅在分配失败时转交同名的原版 operator new，
+ * 由它执行 new_handler 循环：普通版最后抛 bad_alloc，nothrow 版在 handler 为空（或抛出）时返回 NULL。
+ * 用 asm 符号名以适配 size_t 的 mangling。 */
+#if __SIZEOF_SIZE_T__ == 8
+#define MS "m"
+#else
+#define MS "j"
+#endif
+#define NT "RKSt9nothrow_t"
+#define AV "St11align_val_t"
+
+static void* cxx_alloc(size_t sz, size_t align, int kind){
+    if(!sz) sz = 1;
+    void* p;
+    if(!hook_ready()) return boot_alloc(sz, align);
+    if(align <= 16) p = real_malloc(sz);
+    else if(real_posix_memalign(&p, align, sz) != 0) p = NULL;
+    record_alloc(p, sz, kind);
+    return p;
+}
+/* 分配失败：交给 libstdc++ 原版处理 new_handler / 抛异常；
+   它内部的 malloc 已被上面的 hook 记录，这里只把来源改成 new/new[] */
+static void* cxx_fail(const char* sym, size_t sz, size_t align, const void* nt){
+    void* f = dlsym(RTLD_NEXT, sym);
+    if(!f) abort();
+    void* p;
+    if(nt) p = align ? ((void*(*)(size_t,size_t,const void*))f)(sz, align, nt) : ((void*(*)(size_t,const void*))f)(sz, nt);
+    else   p = align ? ((void*(*)(size_t,size_t))f)(sz, align) : ((void*(*)(size_t))f)(sz);
+    if(!p) return NULL;
+    int b = h32((uint64_t)p) & (HSIZE-1);
+    pthread_mutex_lock(&g_mu[b]);
+    for(Node* n=g_tab[b]; n; n=n->next)
+        if(n->ptr==p){ n->kind = strncmp(sym, "_Zna", 4) ? K_NEW : K_NEW_ARR; break; }
+    pthread_mutex_unlock(&g_mu[b]);
+    return p;
+}
+static void cxx_free(void* p, int kind){
+    if(!p || is_boot(p)) return;
+    record_free(p, free_group(kind), NULL);
+    real_free(p);
+}
+
+void* lh_new(size_t)                                   __asm__("_Znw" MS);
+void* lh_new_arr(size_t)                               __asm__("_Zna" MS);
+void* lh_new_nt(size_t, const void*)                   __asm__("_Znw" MS NT);
+void* lh_new_arr_nt(size_t, const void*)               __asm__("_Zna" MS NT);
+void* lh_new_al(size_t, size_t)                        __asm__("_Znw" MS AV);
+void* lh_new_arr_al(size_t, size_t)                    __asm__("_Zna" MS AV);
+void* lh_new_al_nt(size_t, size_t, const void*)        __asm__("_Znw" MS AV NT);
+void* lh_new_arr_al_nt(size_t, size_t, const void*)    __asm__("_Zna" MS AV NT);
+void  lh_del(void*)                                    __asm__("_ZdlPv");
+void  lh_del_arr(void*)                                __asm__("_ZdaPv");
+void  lh_del_sz(void*, size_t)                         __asm__("_ZdlPv" MS);
+void  lh_del_arr_sz(void*, size_t)                     __asm__("_ZdaPv" MS);
+void  lh_del_nt(void*, const void*)                    __asm__("_ZdlPv" NT);
+void  lh_del_arr_nt(void*, const void*)                __asm__("_ZdaPv" NT);
+void  lh_del_al(void*, size_t)                         __asm__("_ZdlPv" AV);
+void  lh_del_arr_al(void*, size_t)                     __asm__("_ZdaPv" AV);
+void  lh_del_sz_al(void*, size_t, size_t)              __asm__("_ZdlPv" MS AV);
+void  lh_del_arr_sz_al(void*, size_t, size_t)          __asm__("_ZdaPv" MS AV);
+void  lh_del_al_nt(void*, size_t, const void*)         __asm__("_ZdlPv" AV NT);
+void  lh_del_arr_al_nt(void*, size_t, const void*)     __asm__("_ZdaPv" AV NT);
+
+void* lh_new(size_t sz){ void* p = cxx_alloc(sz, 0, K_NEW); return p ? p : cxx_fail("_Znw" MS, sz, 0, NULL); }
+void* lh_new_arr(size_t sz){ void* p = cxx_alloc(sz, 0, K_NEW_ARR); return p ? p : cxx_fail("_Zna" MS, sz, 0, NULL); }
+void* lh_new_nt(size_t sz, const void* nt){ void* p = cxx_alloc(sz, 0, K_NEW); return p ? p : cxx_fail("_Znw" MS NT, sz, 0, nt); }
+void* lh_new_arr_nt(size_t sz, const void* nt){ void* p = cxx_alloc(sz, 0, K_NEW_ARR); return p ? p : cxx_fail("_Zna" MS NT, sz, 0, nt); }
+void* lh_new_al(size_t sz, size_t al){ void* p = cxx_alloc(sz, al, K_NEW); return p ? p : cxx_fail("_Znw" MS AV, sz, al, NULL); }
+void* lh_new_arr_al(size_t sz, size_t al){ void* p = cxx_alloc(sz, al, K_NEW_ARR); return p ? p : cxx_fail("_Zna" MS AV, sz, al, NULL); }
+void* lh_new_al_nt(size_t sz, size_t al, const void* nt){ void* p = cxx_alloc(sz, al, K_NEW); return p ? p : cxx_fail("_Znw" MS AV NT, sz, al, nt); }
+void* lh_new_arr_al_nt(size_t sz, size_t al, const void* nt){ void* p = cxx_alloc(sz, al, K_NEW_ARR); return p ? p : cxx_fail("_Zna" MS AV NT, sz, al, nt); }
+void  lh_del(void* p){ cxx_free(p, K_NEW); }
+void  lh_del_arr(void* p){ cxx_free(p, K_NEW_ARR); }
+void  lh_del_sz(void* p, size_t){ cxx_free(p, K_NEW); }
+void  lh_del_arr_sz(void* p, size_t){ cxx_free(p, K_NEW_ARR); }
+void  lh_del_nt(void* p, const void*){ cxx_free(p, K_NEW); }
+void  lh_del_arr_nt(void* p, const void*){ cxx_free(p, K_NEW_ARR); }
+void  lh_del_al(void* p, size_t){ cxx_free(p, K_NEW); }
+void  lh_del_arr_al(void* p, size_t){ cxx_free(p, K_NEW_ARR); }
+void  lh_del_sz_al(void* p, size_t, size_t){ cxx_free(p, K_NEW); }
+void  lh_del_arr_sz_al(void* p, size_t, size_t){ cxx_free(p, K_NEW_ARR); }
+void  lh_del_al_nt(void* p, size_t, const void*){ cxx_free(p, K_NEW); }
+void  lh_del_arr_al_nt(void* p, size_t, const void*){ cxx_free(p, K_NEW_ARR); }
 
 // 信号触发报告： kill -USR1 <pid>
 #include <signal.h>
+static void print_bt(void* const* bt, int n){
+    if(n<=0) return;
+    char** syms = backtrace_symbols(bt, n);
+    if(syms){
+        for(int j=0;j<n;j++) fprintf(stderr,"    %s\n", syms[j]);
+        real_free(syms);
+    }
+}
+static int dump_maps(MapNode* t, int printed){
+    if(!t || printed>=50) return printed;
+    printed = dump_maps(t->l, printed);
+    if(printed<50){
+        fprintf(stderr," map=%p-%p size=%zu prot=%d flags=0x%x fd=%d tid=%llu bt=%d\n",
+            (void*)t->start, (void*)t->end, (size_t)(t->end - t->start), t->prot, t->flags, t->fd,
+            (unsigned long long)t->tid, t->bt_n);
+        print_bt(t->bt, t->bt_n);
+        printed++;
+    }
+    return dump_maps(t->r, printed);
+}
+/* 在 SIGUSR1 处理函数里跑：被打断的线程可能正持有某个桶锁或 g_maps_mu（record_alloc/record_map 中），
+ * 一律 trylock，拿不到就跳过那部分，不能在自己持有的锁上死等 */
 static void dump_report(){
-    fprintf(stderr,"[leakhook] inuse=%zu bytes, report top (by size) ...\n", (size_t)atomic_load(&g_inuse));
+    int saved_guard = t_in_hook;
+    t_in_hook = 1;   // backtrace_symbols 的 malloc 不入表
+    int maps_locked = pthread_mutex_trylock(&g_maps_mu) == 0;
+    char regions[24] = "?";
+    if(maps_locked) snprintf(regions, sizeof(regions), "%zu", g_mmap_regions);
+    fprintf(stderr,"[leakhook] inuse=%zu bytes (usable=%zu), mmap=%zu bytes in %s regions, mismatched free=%zu\n",
+        (size_t)atomic_load(&g_inuse), (size_t)atomic_load(&g_usable),
+        (size_t)atomic_load(&g_mmap_inuse), regions, (size_t)atomic_load(&g_mismatch));
+    fprintf(stderr,"[leakhook] report top (by size) ...\n");
     // 简单按桶扫描，打印若干条目；生产上可做聚合(按回溯签名哈希)
-    int printed=0;
+    int printed=0, busy=0;
     for(int i=0;i<HSIZE && printed<100;i++){
-        pthread_mutex_lock(&g_mu[i]);
+        if(pthread_mutex_trylock(&g_mu[i]) != 0){ busy++; continue; }
         for(Node* n=g_tab[i]; n && printed<100; n=n->next){
-            fprintf(stderr," ptr=%p size=%zu tid=%llu bt=%d\n",
-                n->ptr, n->size, (unsigned long long)n->tid, n->bt_n);
-            if(n->bt_n>0){
-                char** syms = backtrace_symbols(n->bt, n->bt_n);
-                if(syms){
-                    for(int j=0;j<n->bt_n;j++) fprintf(stderr,"    %s\n", syms[j]);
-                    real_free(syms);
-                }
-            }
+            fprintf(stderr," ptr=%p size=%zu usable=%zu kind=%s tid=%llu bt=%d\n",
+                n->ptr, n->size, n->usable, kind_name(n->kind), (unsigned long long)n->tid, n->bt_n);
+            print_bt(n->bt, n->bt_n);
             printed++;
         }
         pthread_mutex_unlock(&g_mu[i]);
     }
+    if(busy) fprintf(stderr,"[leakhook] %d busy buckets skipped\n", busy);
+    if(maps_locked){
+        if(g_maps) fprintf(stderr,"[leakhook] mmap regions (by address, first 50) ...\n");
+        dump_maps(g_maps, 0);
+        pthread_mutex_unlock(&g_maps_mu);
+    }else fprintf(stderr,"[leakhook] mmap regions: map table busy, skipped\n");
+    t_in_hook = saved_guard;
+}
+
+/* ---- 可达性扫描（LeakSanitizer 式保守扫描）：调用 leakhook_leak_check()，或 LEAKHOOK_LEAK_CHECK=1 时 kill -USR2 <pid> ----
+ * 1) 锁住全部哈希桶与 mmap 树，把在存块建成按地址排序的索引；
+ * 2) 用 STOP_SIG 暂停其余线程（处理函数在首次扫描时才安装），各线程在信号处理函数里上报栈指针后自旋等待
+ *    （寄存器已被内核压进栈上的信号帧，从该点往上扫到栈顶即覆盖寄存器）；
+ * 3) 以 .data/.bss、各线程栈、主线程的静态 TLS 与线程描述符为根，多线程扫描指针宽度的值，命中即标记并把块内容入队；
+ *    没应答暂停的线程（屏蔽了 STOP_SIG 等）从 /proc/self/task/<tid>/syscall 取 sp，栈照扫，但寄存器不在根里；
+ * 4) 未标记者为泄漏，按 LSan 的方式归因：先把被其它泄漏块引用到的标出来，没被引用的报确定泄漏并沿引用把能到的记为间接；
+ *    剩下的只在泄漏环里（互相引用、外面没有入口），每个环取第一个报确定，其余同样记间接。
+ * 限制：dlopen 模块的动态 TLS 只经线程描述符里的 dtv 间接可达，主线程的 dtv 数组本身不扫。 */
+#define STOP_SIG        (SIGRTMIN+3)
+#define SCAN_CHUNK      (256*1024)     // 根/大块按此切片，分给各扫描线程
+#define SCAN_MAX_THR    16
+#define STW_MAX         4096           // 最多暂停的线程数
+#define MAPS_MAX        65536
+#define LEAK_TOP        100
+
+typedef struct { uintptr_t start, end; void* owner; uint8_t is_map, scan; } Blk;
+typedef struct { uintptr_t lo, hi; } Range;
+typedef struct { uintptr_t lo, hi; int r; } MapsEnt;
+typedef struct { void* ptr; size_t size; uint64_t tid; int kind; int bt_n; void* bt[16]; } LeakRec;
+
+static struct {
+    Blk* blk; size_t nblk;
+    _Atomic uint8_t* mark;             // 0=未达 1=可达 2=被泄漏块引用 3=确定泄漏 4=间接泄漏
+    uintptr_t lo, hi;                  // 索引覆盖的地址范围，快速排除
+    _Atomic uint64_t* q; size_t qcap;  // 待扫切片： (chunk<<32) | (blk+1)
+    atomic_size_t qhead, qtail;
+    Range* roots; size_t nroots;
+    atomic_size_t next_root, next_blk; // 两阶段各用一个游标：阶段一的落后者不会踩到阶段二
+    atomic_long pending;               // 已入队/未扫完的切片数，归零即结束
+    pthread_barrier_t bar;
+    sem_t go;                          // 线程数定下、barrier 建好后放行 worker
+} g_scan;
+
+static pthread_mutex_t g_scan_mu = PTHREAD_MUTEX_INITIALIZER;
+static sem_t g_scan_sem;
+static atomic_int g_stw_hold = 0, g_stw_ack = 0;
+static atomic_size_t g_stw_n = 0;
+static uintptr_t g_stw_sp[STW_MAX];
+static pid_t g_stw_tid[STW_MAX];
+static uintptr_t g_main_tp;            // 主线程的 pthread_self()，其静态 TLS 不在任何栈里
+
+static void* scratch(size_t sz){
+    void* p = real_mmap(NULL, sz ? sz : 1, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+static void scratch_free(void* p, size_t sz){ if(p) real_munmap(p, sz ? sz : 1); }
+
+static void on_stop(int){
+    int e = errno;
+    volatile char here = 0;
+    size_t slot = atomic_fetch_add(&g_stw_n, 1);
+    if(slot < STW_MAX){ g_stw_sp[slot] = (uintptr_t)&here; g_stw_tid[slot] = (pid_t)syscall(SYS_gettid); }
+    atomic_fetch_add(&g_stw_ack, 1);
+    while(atomic_load(&g_stw_hold)) sched_yield();
+    errno = e;
+}
+
+static long blk_find(uintptr_t v){
+    if(v < g_scan.lo || v >= g_scan.hi) return -1;
+    size_t l = 0, r = g_scan.nblk;             // 第一个 start > v
+    while(l < r){ size_t m = (l + r) / 2; if(g_scan.blk[m].start <= v) l = m + 1; else r = m; }
+    if(!l || v >= g_scan.blk[l-1].end) return -1;
+    return (long)(l - 1);
+}
+static size_t blk_chunks(const Blk* b){ return b->scan ? (b->end - b->start + SCAN_CHUNK - 1) / SCAN_CHUNK : 0; }
+
+static void mark_hit(long i, uint8_t val){
+    uint8_t z = 0;
+    if(!atomic_compare_exchange_strong(&g_scan.mark[i], &z, val)) return;
+    if(val != 1) return;                       // 间接阶段不传播：所有未达块都会被当作根扫一遍
+    size_t n = blk_chunks(&g_scan.blk[i]);
+    if(!n) return;
+    atomic_fetch_add(&g_scan.pending, (long)n);
+    for(size_t c=0;c<n;c++){
+        size_t t = atomic_fetch_add(&g_scan.qtail, 1);
+        atomic_store_explicit(&g_scan.q[t], ((uint64_t)c << 32) | (uint64_t)(i + 1), memory_order_release);
+    }
+}
+static void scan_words(uintptr_t lo, uintptr_t hi, uint8_t val, long self){
+    lo = (lo + sizeof(void*) - 1) & ~(uintptr_t)(sizeof(void*) - 1);
+    for(; lo + sizeof(void*) <= hi; lo += sizeof(void*)){
+        long i = blk_find(*(const uintptr_t*)lo);
+        if(i >= 0 && i != self) mark_hit(i, val);
+    }
+}
+static int q_pop(uint64_t* out){
+    size_t h = atomic_load(&g_scan.qhead);
+    while(h < atomic_load(&g_scan.qtail)){
+        if(atomic_compare_exchange_weak(&g_scan.qhead, &h, h + 1)){
+            uint64_t v;
+            while(!(v = atomic_load_explicit(&g_scan.q[h], memory_order_acquire))) sched_yield();
+            *out = v; return 1;
+        }
+    }
+    return 0;
+}
+
+static void scan_phase1(void){
+    for(;;){
+        size_t c = atomic_fetch_add(&g_scan.next_root, 1);
+        if(c < g_scan.nroots){
+            scan_words(g_scan.roots[c].lo, g_scan.roots[c].hi, 1, -1);
+            atomic_fetch_sub(&g_scan.pending, 1);
+            continue;
+        }
+        uint64_t it;
+        if(q_pop(&it)){
+            long i = (long)(it & 0xffffffffu) - 1;
+            const Blk* b = &g_scan.blk[i];
+            uintptr_t lo = b->start + (uintptr_t)(it >> 32) * SCAN_CHUNK;
+            uintptr_t hi = lo + SCAN_CHUNK < b->end ? lo + SCAN_CHUNK : b->end;
+            scan_words(lo, hi, 1, -1);
+            atomic_fetch_sub(&g_scan.pending, 1);
+            continue;
+        }
+        if(atomic_load(&g_scan.pending) <= 0) break;
+        sched_yield();
+    }
+}
+static void scan_phase2(void){
+    for(;;){
+        size_t s = atomic_fetch_add(&g_scan.next_blk, 256);
+        if(s >= g_scan.nblk) break;
+        size_t e = s + 256 < g_scan.nblk ? s + 256 : g_scan.nblk;
+        for(size_t i=s;i<e;i++){
+            const Blk* b = &g_scan.blk[i];
+            if(atomic_load(&g_scan.mark[i]) != 1 && b->scan) scan_words(b->start, b->end, 2, (long)i);
+        }
+    }
+}
+
+typedef struct { pthread_t th; pid_t tid; } ScanWorker;
+static void* scan_worker(void* arg){
+    ScanWorker* w = arg;
+    t_in_hook = 1;
+    w->tid = (pid_t)syscall(SYS_gettid);
+    while(sem_wait(&g_scan.go) != 0) {}
+    pthread_barrier_wait(&g_scan.bar);      // tid 就绪
+    pthread_barrier_wait(&g_scan.bar);      // 根已收集
+    scan_phase1();
+    pthread_barrier_wait(&g_scan.bar);
+    scan_phase2();
+    pthread_barrier_wait(&g_scan.bar);
+    return NULL;
+}
+
+static int blk_cmp(const void* a, const void* b){
+    uintptr_t x = ((const Blk*)a)->start, y = ((const Blk*)b)->start;
+    return (x > y) - (x < y);
+}
+static size_t add_map_blks(MapNode* t, Blk* out, size_t n){
+    if(!t) return n;
+    n = add_map_blks(t->l, out, n);
+    out[n].start = t->start; out[n].end = t->end; out[n].owner = t; out[n].is_map = 1;
+    out[n].scan = (t->prot & PROT_READ) && (t->flags & MAP_ANONYMOUS);   // 文件/设备映射只标记不读
+    n++;
+    return add_map_blks(t->r, out, n);
+}
+
+typedef struct { Range* r; size_t n, cap; } RangeVec;
+#define TLS_MOD_MAX     256
+typedef struct { RangeVec* v; size_t ntls; Range tls[TLS_MOD_MAX]; } PhdrArg;
+static int phdr_cb(struct dl_phdr_info* info, size_t, void* arg){
+    PhdrArg* a = arg;
+    RangeVec* v = a->v;
+    uintptr_t self = (uintptr_t)&g_tab;
+    for(int i=0;i<info->dlpi_phnum;i++){
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        // 调用线程里各模块的 TLS 块；静态 TLS 相对线程描述符的偏移对所有线程相同，换到主线程用
+        if(ph->p_type == PT_TLS && info->dlpi_tls_data && a->ntls < TLS_MOD_MAX){
+            a->tls[a->ntls].lo = (uintptr_t)info->dlpi_tls_data;
+            a->tls[a->ntls].hi = (uintptr_t)info->dlpi_tls_data + ph->p_memsz;
+            a->ntls++;
+        }
+    }
+    for(int i=0;i<info->dlpi_phnum;i++){          // 跳过 leakhook 自身（哈希表里全是指针）
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        uintptr_t lo = info->dlpi_addr + ph->p_vaddr;
+        if(ph->p_type == PT_LOAD && self >= lo && self < lo + ph->p_memsz) return 0;
+    }
+    for(int i=0;i<info->dlpi_phnum && v->n<v->cap;i++){
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        if(ph->p_type != PT_LOAD || !(ph->p_flags & PF_W)) continue;
+        uintptr_t lo = info->dlpi_addr + ph->p_vaddr;
+        v->r[v->n].lo = lo; v->r[v->n].hi = lo + ph->p_memsz; v->n++;
+    }
+    return 0;
+}
+
+/* 只用系统调用读 /proc/self/maps（此时其它线程已停，可能持有 malloc 锁） */
+static size_t read_maps(MapsEnt* out, size_t cap, char* buf, size_t bufsz){
+    int fd = open("/proc/self/maps", O_RDONLY|O_CLOEXEC);
+    if(fd < 0) return 0;
+    size_t len = 0;
+    ssize_t k;
+    while(len < bufsz - 1 && (k = read(fd, buf + len, bufsz - 1 - len)) > 0) len += (size_t)k;
+    close(fd);
+    buf[len] = '\0';
+    size_t n = 0;
+    for(char* p = buf; *p && n < cap; ){
+        char* q;
+        out[n].lo = strtoul(p, &q, 16);
+        out[n].hi = (*q == '-') ? strtoul(q + 1, &q, 16) : out[n].lo;
+        out[n].r = (q[0] == ' ' && q[1] == 'r');
+        n++;
+        char* nl = strchr(p, '\n');
+        if(!nl) break;
+        p = nl + 1;
+    }
+    return n;
+}
+static const MapsEnt* maps_at(const MapsEnt* m, size_t n, uintptr_t a){
+    size_t l = 0, r = n;
+    while(l < r){ size_t k = (l + r) / 2; if(m[k].lo <= a) l = k + 1; else r = k; }
+    return (l && a < m[l-1].hi) ? &m[l-1] : NULL;
+}
+static int maps_readable(const MapsEnt* m, size_t n, uintptr_t lo, uintptr_t hi){
+    while(lo < hi){
+        const MapsEnt* e = maps_at(m, n, lo);
+        if(!e || !e->r) return 0;
+        lo = e->hi;
+    }
+    return 1;
+}
+
+/* 没应答暂停的线程：阻塞在系统调用里时 /proc/self/task/<tid>/syscall 末尾两项是 sp、pc */
+static uintptr_t task_sp(pid_t tid){
+    char path[64], buf[256];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/syscall", (int)tid);
+    int fd = open(path, O_RDONLY|O_CLOEXEC);
+    if(fd < 0) return 0;
+    ssize_t k = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if(k <= 0) return 0;
+    buf[k] = '\0';
+    if(!strncmp(buf, "running", 7)) return 0;
+    char* f[10]; int nf = 0;
+    for(char* p = buf; *p && nf < 10; ){
+        while(*p == ' ' || *p == '\n') p++;
+        if(!*p) break;
+        f[nf++] = p;
+        while(*p && *p != ' ' && *p != '\n') p++;
+    }
+    return nf >= 3 ? (uintptr_t)strtoul(f[nf-2], NULL, 16) : 0;
+}
+
+/* 阶段三（单线程）：从确定泄漏块 i 出发，把能到的"被泄漏块引用"（2）的块改记间接（4） */
+static void leak_flood(size_t i, size_t* stk){
+    size_t sp = 0;
+    stk[sp++] = i;
+    while(sp){
+        const Blk* b = &g_scan.blk[stk[--sp]];
+        if(!b->scan) continue;
+        uintptr_t lo = (b->start + sizeof(void*) - 1) & ~(uintptr_t)(sizeof(void*) - 1);
+        for(; lo + sizeof(void*) <= b->end; lo += sizeof(void*)){
+            long j = blk_find(*(const uintptr_t*)lo);
+            if(j >= 0 && atomic_load(&g_scan.mark[j]) == 2){ atomic_store(&g_scan.mark[j], 4); stk[sp++] = (size_t)j; }
+        }
+    }
+}
+
+static void leak_insert(LeakRec* top, int* n, const Blk* b){
+    size_t sz = b->end - b->start;
+    if(*n == LEAK_TOP && top[LEAK_TOP-1].size >= sz) return;
+    int i = (*n < LEAK_TOP) ? (*n)++ : LEAK_TOP - 1;
+    while(i > 0 && top[i-1].size < sz){ top[i] = top[i-1]; i--; }
+    LeakRec* r = &top[i];
+    r->ptr = (void*)b->start; r->size = sz;
+    if(b->is_map){ const MapNode* m = b->owner; r->tid = m->tid; r->kind = K_MMAP; r->bt_n = m->bt_n; memcpy(r->bt, m->bt, sizeof(r->bt)); }
+    else         { const Node* m = b->owner;    r->tid = m->tid; r->kind = m->kind; r->bt_n = m->bt_n; memcpy(r->bt, m->bt, sizeof(r->bt)); }
+}
+
+static int scan_threads(){
+    const char* e = getenv("LEAKHOOK_SCAN_THREADS");
+    long n = e ? atol(e) : sysconf(_SC_NPROCESSORS_ONLN);
+    if(!e && n > 8) n = 8;
+    if(n < 1) n = 1;
+    if(n > SCAN_MAX_THR) n = SCAN_MAX_THR;
+    return (int)n;
+}
+
+static void install_stop(void){
+    // 暂停信号常驻：扫描超时后才到达的信号也只会进来转一圈就返回
+    struct sigaction ss={0}; ss.sa_handler=on_stop; ss.sa_flags=SA_RESTART; sigaction(STOP_SIG,&ss,NULL);
+}
+static pthread_once_t g_stop_once = PTHREAD_ONCE_INIT;
+
+/* 调用线程不会被暂停：它的栈从本函数的帧往上作为根，
+ * 其中含 leakhook_leak_check 用 __builtin_unwind_init 落到栈上的被调用者保存寄存器。 */
+static __attribute__((noinline)) size_t do_leak_check(void){
+    if(!hook_ready()) return 0;
+    uintptr_t stack_lo = (uintptr_t)__builtin_frame_address(0);
+    pthread_once(&g_stop_once, install_stop);
+    pthread_mutex_lock(&g_scan_mu);
+    int saved_guard = t_in_hook;
+    t_in_hook = 1;
+    struct timespec t0, t1; clock_gettime(CLOCK_MONOTONIC, &t0);
+    pid_t self = (pid_t)syscall(SYS_gettid), pid = getpid();
+
+    /* -- 世界暂停前：所有可能 malloc / 拿 loader 锁的准备工作 -- */
+    size_t reach_n = 0, reach_b = 0, direct_n = 0, direct_b = 0, indir_n = 0, indir_b = 0;
+    size_t nroots = 0, qcap = 0, nblk = 0;
+    int ntop = 0;
+    int nthr = scan_threads();
+    ScanWorker wk[SCAN_MAX_THR];
+    sem_init(&g_scan.go, 0, 0);
+    int nwk = 0;
+    for(int i=0;i<nthr-1;i++){      // worker 先停在 go 上，建成几个算几个
+        wk[nwk].tid = 0;
+        if(pthread_create(&wk[nwk].th, NULL, scan_worker, &wk[nwk]) == 0) nwk++;
+    }
+    if(nwk != nthr-1) fprintf(stderr, "[leakhook] leak check: only %d/%d scan threads\n", nwk + 1, nthr);
+    nthr = nwk + 1;
+    pthread_barrier_init(&g_scan.bar, NULL, (unsigned)nthr);
+    for(int i=0;i<nwk;i++) sem_post(&g_scan.go);
+    pthread_barrier_wait(&g_scan.bar);
+
+    size_t raw_cap = 4096 + STW_MAX + 2;         // 可写段 + 各线程栈 + 调用者栈 + 主线程 TLS
+    RangeVec raw = { scratch(raw_cap * sizeof(Range)), 0, raw_cap - STW_MAX - 2 };
+    PhdrArg* pa = scratch(sizeof(PhdrArg));
+    pid_t* tids = scratch(STW_MAX * sizeof(pid_t));
+    size_t maps_bytes = 8u << 20;
+    char* maps_buf = scratch(maps_bytes);
+    MapsEnt* maps = scratch(MAPS_MAX * sizeof(MapsEnt));
+    LeakRec* top = scratch(LEAK_TOP * sizeof(LeakRec));
+    if(!raw.r || !tids || !maps_buf || !maps || !top || !pa){
+        fprintf(stderr, "[leakhook] leak check: out of memory\n");
+        goto out_workers;
+    }
+    pa->v = &raw; pa->ntls = 0;
+    dl_iterate_phdr(phdr_cb, pa);
+    raw.cap = raw_cap;
+    size_t ntid = 0;
+    DIR* d = opendir("/proc/self/task");
+    if(d){
+        struct dirent* de;
+        while((de = readdir(d)) && ntid < STW_MAX){
+            pid_t t = (pid_t)atoi(de->d_name);
+            int skip = (t <= 0 || t == self);
+            for(int i=0;i<nwk && !skip;i++) skip = (t == wk[i].tid);
+            if(!skip) tids[ntid++] = t;
+        }
+        closedir(d);
+    }
+
+    /* -- 锁表，建索引 -- */
+    for(int i=0;i<HSIZE;i++) pthread_mutex_lock(&g_mu[i]);
+    pthread_mutex_lock(&g_maps_mu);
+    nblk = g_mmap_regions;
+    for(int i=0;i<HSIZE;i++) for(Node* n=g_tab[i]; n; n=n->next) nblk++;
+    g_scan.blk  = scratch(nblk * sizeof(Blk));
+    g_scan.mark = scratch(nblk);
+    size_t* stk = scratch(nblk * sizeof(size_t));
+    g_scan.nblk = 0;
+    if(g_scan.blk && g_scan.mark){
+        for(int i=0;i<HSIZE;i++) for(Node* n=g_tab[i]; n; n=n->next){
+            Blk* b = &g_scan.blk[g_scan.nblk++];
+            b->start = (uintptr_t)n->ptr; b->end = b->start + (n->size ? n->size : 1);
+            b->owner = n; b->is_map = 0; b->scan = 1;
+        }
+        g_scan.nblk = add_map_blks(g_maps, g_scan.blk, g_scan.nblk);
+        qsort(g_scan.blk, g_scan.nblk, sizeof(Blk), blk_cmp);
+    }
+    g_scan.lo = g_scan.nblk ? g_scan.blk[0].start : 0;
+    g_scan.hi = g_scan.nblk ? g_scan.blk[g_scan.nblk-1].end : 0;
+    for(size_t i=0;i<g_scan.nblk;i++) if(g_scan.blk[i].end > g_scan.hi) g_scan.hi = g_scan.blk[i].end;
+
+    /* -- 暂停其余线程 -- */
+    atomic_store(&g_stw_hold, 1); atomic_store(&g_stw_ack, 0); atomic_store(&g_stw_n, 0);
+    int sent = 0;
+    for(size_t i=0;i<ntid;i++) if(syscall(SYS_tgkill, pid, tids[i], STOP_SIG) == 0) sent++;
+    for(int waited=0; atomic_load(&g_stw_ack) < sent && waited < 2000; waited++){
+        struct timespec ms = {0, 1000000}; nanosleep(&ms, NULL);     // 已退出的线程不会应答，最多等 2s
+    }
+    int acked = atomic_load(&g_stw_ack);
+
+    /* -- 根：可写段 + 各线程栈（sp 到所在映射顶端） -- */
+    size_t nmaps = read_maps(maps, MAPS_MAX, maps_buf, maps_bytes);
+    size_t nsp = atomic_load(&g_stw_n); if(nsp > STW_MAX) nsp = STW_MAX;
+    for(size_t i=0;i<nsp;i++){
+        const MapsEnt* m = maps_at(maps, nmaps, g_stw_sp[i]);
+        if(m && raw.n < raw.cap){ raw.r[raw.n].lo = g_stw_sp[i]; raw.r[raw.n].hi = m->hi; raw.n++; }
+    }
+    {
+        const MapsEnt* m = maps_at(maps, nmaps, stack_lo);
+        if(m && raw.n < raw.cap){ raw.r[raw.n].lo = stack_lo; raw.r[raw.n].hi = m->hi; raw.n++; }
+    }
+    for(size_t i=0;i<ntid;i++){                   // 没应答的线程：按阻塞点的 sp 扫栈（线程栈顶也含其 TLS）
+        int stopped = 0;
+        for(size_t j=0;j<nsp && !stopped;j++) stopped = (g_stw_tid[j] == tids[i]);
+        uintptr_t sp = stopped ? 0 : task_sp(tids[i]);
+        const MapsEnt* m = sp ? maps_at(maps, nmaps, sp) : NULL;
+        if(m && raw.n < raw.cap){ raw.r[raw.n].lo = sp; raw.r[raw.n].hi = m->hi; raw.n++; }
+    }
+    if(g_main_tp){
+        /* 主线程的静态 TLS 与线程描述符（含 dtv、pthread_setspecific 首级数组）由 ld.so 分配，不在栈上：
+         * 取调用线程与自己描述符同一映射里的 TLS 块，按相对偏移换算到主线程，再并上描述符本身 */
+        uintptr_t me = (uintptr_t)pthread_self();
+        const MapsEnt* mm = maps_at(maps, nmaps, me);
+        intptr_t lo = 0, hi = 4096;
+        for(size_t i=0;mm && i<pa->ntls;i++){
+            if(maps_at(maps, nmaps, pa->tls[i].lo) != mm) continue;     // dlopen 模块的动态 TLS 在堆上，不算
+            intptr_t a = (intptr_t)(pa->tls[i].lo - me), b = (intptr_t)(pa->tls[i].hi - me);
+            if(a < lo) lo = a;
+            if(b > hi) hi = b;
+        }
+        const MapsEnt* m = maps_at(maps, nmaps, g_main_tp);
+        if(m && raw.n < raw.cap){
+            uintptr_t rlo = g_main_tp + (uintptr_t)lo, rhi = g_main_tp + (uintptr_t)hi;
+            raw.r[raw.n].lo = rlo > m->lo ? rlo : m->lo;
+            raw.r[raw.n].hi = rhi < m->hi ? rhi : m->hi;
+            raw.n++;
+        }
+    }
+    for(size_t i=0;i<raw.n;i++){
+        if(!maps_readable(maps, nmaps, raw.r[i].lo, raw.r[i].hi)) raw.r[i].hi = raw.r[i].lo;   // 例如 RELRO 之外被 mprotect 的段
+        nroots += (raw.r[i].hi - raw.r[i].lo + SCAN_CHUNK - 1) / SCAN_CHUNK;
+    }
+    for(size_t i=0;i<g_scan.nblk;i++){
+        Blk* b = &g_scan.blk[i];
+        if(b->is_map && b->scan && !maps_readable(maps, nmaps, b->start, b->end)) b->scan = 0;
+        qcap += blk_chunks(b);
+    }
+    g_scan.roots = scratch(nroots * sizeof(Range));
+    g_scan.q = scratch(qcap * sizeof(uint64_t));
+    g_scan.nroots = 0; g_scan.qcap = qcap;
+    if(g_scan.roots){
+        for(size_t i=0;i<raw.n;i++){
+            for(uintptr_t lo = raw.r[i].lo; lo < raw.r[i].hi; lo += SCAN_CHUNK){
+                Range* r = &g_scan.roots[g_scan.nroots++];
+                r->lo = lo; r->hi = (raw.r[i].hi - lo > SCAN_CHUNK) ? lo + SCAN_CHUNK : raw.r[i].hi;
+            }
+        }
+    }
+
+    /* -- 并行标记 -- */
+    int ok = g_scan.blk && g_scan.mark && stk && g_scan.roots && (g_scan.q || !qcap);
+    if(!ok) g_scan.nroots = 0, g_scan.nblk = 0;          // 仍需走完 barrier，让 worker 退出
+    atomic_store(&g_scan.qhead, 0); atomic_store(&g_scan.qtail, 0);
+    atomic_store(&g_scan.next_root, 0); atomic_store(&g_scan.next_blk, 0);
+    atomic_store(&g_scan.pending, (long)g_scan.nroots);
+    pthread_barrier_wait(&g_scan.bar);
+    scan_phase1();
+    pthread_barrier_wait(&g_scan.bar);
+    scan_phase2();
+    pthread_barrier_wait(&g_scan.bar);
+
+    /* 阶段三：没被泄漏块引用的未达块是确定泄漏；之后还剩 2 的只在泄漏环里，每个环挑第一个报确定 */
+    for(int pass=0;pass<2;pass++)
+        for(size_t i=0;i<g_scan.nblk;i++)
+            if(atomic_load(&g_scan.mark[i]) == (pass ? 2 : 0)){ atomic_store(&g_scan.mark[i], 3); leak_flood(i, stk); }
+    for(size_t i=0;i<g_scan.nblk;i++){
+        const Blk* b = &g_scan.blk[i];
+        size_t sz = b->end - b->start;
+        switch(atomic_load(&g_scan.mark[i])){
+            case 1:  reach_n++;  reach_b += sz; break;
+            case 4:  indir_n++;  indir_b += sz; break;
+            default: direct_n++; direct_b += sz; leak_insert(top, &ntop, b); break;
+        }
+    }
+
+    /* -- 恢复 -- */
+    atomic_store(&g_stw_hold, 0);
+    pthread_mutex_unlock(&g_maps_mu);
+    for(int i=HSIZE-1;i>=0;i--) pthread_mutex_unlock(&g_mu[i]);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    if(!ok) fprintf(stderr, "[leakhook] leak check: out of memory while indexing\n");
+    fprintf(stderr, "[leakhook] leak check: %zu blocks, %d/%d threads stopped, %zu root chunks, %d scan threads, %.3fs\n",
+        g_scan.nblk, acked, sent, g_scan.nroots, nthr, secs);
+    fprintf(stderr, "[leakhook] reachable=%zu bytes in %zu blocks; direct leak=%zu bytes in %zu blocks; indirect leak=%zu bytes in %zu blocks\n",
+        reach_b, reach_n, direct_b, direct_n, indir_b, indir_n);
+    for(int i=0;i<ntop;i++){
+        fprintf(stderr, " leak ptr=%p size=%zu kind=%s tid=%llu bt=%d\n",
+            top[i].ptr, top[i].size, kind_name(top[i].kind), (unsigned long long)top[i].tid, top[i].bt_n);
+        print_bt(top[i].bt, top[i].bt_n);
+    }
+    if((size_t)ntop < direct_n) fprintf(stderr, " ... (%zu more direct leaks)\n", direct_n - (size_t)ntop);
+
+    scratch_free(g_scan.roots, nroots * sizeof(Range));
+    scratch_free(g_scan.q, qcap * sizeof(uint64_t));
+    scratch_free(g_scan.blk, nblk * sizeof(Blk));
+    scratch_free(g_scan.mark, nblk);
+    scratch_free(stk, nblk * sizeof(size_t));
+    g_scan.blk = NULL; g_scan.mark = NULL; g_scan.roots = NULL; g_scan.q = NULL;
+out_workers:
+    if(!raw.r || !tids || !maps_buf || !maps || !top || !pa){
+        g_scan.nroots = g_scan.nblk = 0; atomic_store(&g_scan.pending, 0);
+        atomic_store(&g_scan.qhead, 0); atomic_store(&g_scan.qtail, 0);
+        atomic_store(&g_scan.next_root, 0); atomic_store(&g_scan.next_blk, 0);
+        for(int k=0;k<3;k++) pthread_barrier_wait(&g_scan.bar);
+    }
+    for(int i=0;i<nwk;i++) pthread_join(wk[i].th, NULL);
+    pthread_barrier_destroy(&g_scan.bar);
+    sem_destroy(&g_scan.go);
+    scratch_free(raw.r, raw_cap * sizeof(Range));
+    scratch_free(tids, STW_MAX * sizeof(pid_t));
+    scratch_free(maps_buf, maps_bytes);
+    scratch_free(maps, MAPS_MAX * sizeof(MapsEnt));
+    scratch_free(top, LEAK_TOP * sizeof(LeakRec));
+    scratch_free(pa, sizeof(PhdrArg));
+    t_in_hook = saved_guard;
+    pthread_mutex_unlock(&g_scan_mu);
+    return direct_b;
+}
+
+/* 供程序直接调用（例如测试收尾时）；返回确定泄漏字节数 */
+__attribute__((noinline)) size_t leakhook_leak_check(void){
+    // 把被调用者保存寄存器全部压进本帧，一并作为根。不用 setjmp：glibc 的 jmp_buf 里 rbp/rsp/pc 经 PTR_MANGLE，
+    // 只放在 rbp 里的堆指针会漏看，误报成确定泄漏
+    __builtin_unwind_init();
+    size_t r = do_leak_check();
+    __asm__ volatile("" : : "r"(r) : "memory");   // 不做尾调用，本帧在扫描期间保持有效
+    return r;
+}
+
+static void* scan_service(void*){
+    t_in_hook = 1;
+    for(;;){
+        while(sem_wait(&g_scan_sem) != 0) {}
+        leakhook_leak_check();      // 本线程的 TCB（含 dtv）在自己栈顶，同样要扫
+    }
+    return NULL;
+}
+static void on_sigusr2(int){ sem_post(&g_scan_sem); }
+
+/* ---- 看门狗：按阈值自动落盘堆快照（尖峰往往在手动 kill -USR1 之前就过去了） ----
+ * LEAKHOOK_WD_BYTES=N[K|M|G]   heap+mmap 向上穿越 N 时触发
+ * LEAKHOOK_WD_RATE=N[K|M|G]    相邻两次采样的增长速率 >= N 字节/秒时触发
+ * LEAKHOOK_WD_HWM_PCT=X        比上次快照时的真实峰值（期间采样最大值）再涨 X% 时触发，X 为 1..1000 的整数（基线不低于 1MB）
+ * LEAKHOOK_WD_MS=200           采样间隔；LEAKHOOK_WD_COOLDOWN_MS=5000 两次快照的最小间隔，
+ *                              冷却期内的触发会挂起，冷却结束后补拍一次（原因带 deferred）
+ * LEAKHOOK_SNAP_DIR=. LEAKHOOK_SNAP_KEEP=8 LEAKHOOK_SNAP_TOP=50
+ * 快照写到 <dir>/leakhook_snap_<pid>_<slot>.txt，slot 循环复用，最多 KEEP 个文件。
+ * 采集路径只用启动时 mmap 好的聚合表和输出缓冲，落盘用 write/backtrace_symbols_fd，不再 malloc。 */
+#define SNAP_SLOTS      8192           // 聚合表容量（不同调用栈数），满了归入 other
+#define SNAP_TOP_MAX    256
+#define SNAP_BUF        65536
+
+typedef struct { uint32_t hash; int bt_n; uint32_t kinds; size_t bytes, blocks; void* bt[16]; } SnapEnt;
+
+static struct {
+    size_t bytes, rate, hwm_pct, interval_ms, cooldown_ms, keep, top;
+    char dir[256];
+} g_wd;
+static SnapEnt* g_snap_tab;            // SNAP_SLOTS 项
+static uint32_t* g_snap_top;           // SNAP_TOP_MAX 个下标
+static char* g_snap_buf;               // SNAP_BUF 字节
+static size_t g_snap_len;
+static unsigned g_snap_seq;
+
+static size_t env_size(const char* name, size_t def){
+    const char* e = getenv(name);
+    if(!e || !*e) return def;
+    char* end;
+    double v = strtod(e, &end);
+    switch(*end){ case 'g': case 'G': v *= 1024; /* fallthrough */
+                  case 'm': case 'M': v *= 1024; /* fallthrough */
+                  case 'k': case 'K': v *= 1024; break; }
+    return v > 0 ? (size_t)v : 0;
+}
+static size_t env_pct(const char* name){
+    const char* e = getenv(name);
+    if(!e || !*e) return 0;
+    char* end;
+    long v = strtol(e, &end, 10);
+    if(*end || v < 1 || v > 1000){
+        fprintf(stderr, "[leakhook] %s=%s: expected an integer percentage 1..1000, ignored\n", name, e);
+        return 0;
+    }
+    return (size_t)v;
+}
+
+static void snap_flush(int fd){
+    for(size_t off = 0; off < g_snap_len; ){
+        ssize_t k = write(fd, g_snap_buf + off, g_snap_len - off);
+        if(k <= 0){ if(k < 0 && errno == EINTR) continue; break; }
+        off += (size_t)k;
+    }
+    g_snap_len = 0;
+}
+static void snap_printf(int fd, const char* fmt, ...){
+    if(g_snap_len > SNAP_BUF - 512) snap_flush(fd);
+    va_list ap; va_start(ap, fmt);
+    int k = vsnprintf(g_snap_buf + g_snap_len, SNAP_BUF - g_snap_len, fmt, ap);
+    va_end(ap);
+    if(k > 0) g_snap_len += ((size_t)k < SNAP_BUF - g_snap_len) ? (size_t)k : SNAP_BUF - g_snap_len - 1;
+}
+
+static void snap_add(void* const* bt, int bt_n, int kind, size_t sz, size_t* other_b, size_t* other_n){
+    uint32_t h = (uint32_t)bt_n * 0x9e3779b9u;
+    for(int i=0;i<bt_n;i++) h = h32(h ^ (uint64_t)(uintptr_t)bt[i]);
+    for(uint32_t k=0, i=h & (SNAP_SLOTS-1); k<SNAP_SLOTS/2; k++, i=(i+1)&(SNAP_SLOTS-1)){
+        SnapEnt* e = &g_snap_tab[i];
+        if(!e->blocks){
+            e->hash = h; e->bt_n = bt_n; e->kinds = 0;
+            memcpy(e->bt, bt, (size_t)bt_n * sizeof(void*));
+        }else if(e->hash != h || e->bt_n != bt_n || memcmp(e->bt, bt, (size_t)bt_n * sizeof(void*))) continue;
+        e->bytes += sz; e->blocks++; e->kinds |= 1u << kind;
+        return;
+    }
+    *other_b += sz; (*other_n)++;      // 探测过长：表已接近满
+}
+static void snap_add_maps(MapNode* t, size_t* ob, size_t* on){
+    if(!t) return;
+    snap_add_maps(t->l, ob, on);
+    snap_add(t->bt, t->bt_n, K_MMAP, (size_t)(t->end - t->start), ob, on);
+    snap_add_maps(t->r, ob, on);
+}
+
+static void take_snapshot(const char* why, size_t total){
+    memset(g_snap_tab, 0, SNAP_SLOTS * sizeof(SnapEnt));
+    size_t other_b = 0, other_n = 0;
+    for(int i=0;i<HSIZE;i++){         // 逐桶加锁，不整体停表；快照不是严格原子的
+        if(!__atomic_load_n(&g_tab[i], __ATOMIC_RELAXED)) continue;    // 空桶不拿锁；真正的遍历在锁内
+        pthread_mutex_lock(&g_mu[i]);
+        for(Node* n=g_tab[i]; n; n=n->next) snap_add(n->bt, n->bt_n, n->kind, n->size, &other_b, &other_n);
+        pthread_mutex_unlock(&g_mu[i]);
+    }
+    pthread_mutex_lock(&g_maps_mu);
+    snap_add_maps(g_maps, &other_b, &other_n);
+    size_t regions = g_mmap_regions;
+    pthread_mutex_unlock(&g_maps_mu);
+
+    size_t ntop = 0, nstacks = 0;      // 按在存字节取前 top 个（插入排序，top 很小）
+    for(uint32_t i=0;i<SNAP_SLOTS;i++){
+        if(!g_snap_tab[i].blocks) continue;
+        nstacks++;
+        size_t b = g_snap_tab[i].bytes;
+        if(ntop == g_wd.top && g_snap_tab[g_snap_top[ntop-1]].bytes >= b) continue;
+        size_t j = ntop < g_wd.top ? ntop++ : ntop - 1;
+        while(j > 0 && g_snap_tab[g_snap_top[j-1]].bytes < b){ g_snap_top[j] = g_snap_top[j-1]; j--; }
+        g_snap_top[j] = i;
+    }
+
+    char path[300], tmp[310];
+    unsigned slot = g_snap_seq % (unsigned)g_wd.keep;
+    snprintf(path, sizeof(path), "%s/leakhook_snap_%d_%u.txt", g_wd.dir, (int)getpid(), slot);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if(fd < 0){ fprintf(stderr, "[leakhook] snapshot: open %s: %s\n", tmp, strerror(errno)); return; }
+    struct timespec ts; clock_gettime(CLOCK_REALTIME, &ts);
+    g_snap_len = 0;
+    snap_printf(fd, "# leakhook snapshot seq=%u pid=%d wall_ns=%llu reason=%s\n",
+        g_snap_seq, (int)getpid(), (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec, why);
+    snap_printf(fd, "# total=%zu inuse=%zu usable=%zu mmap=%zu regions=%zu stacks=%zu other=%zu bytes in %zu blocks\n",
+        total, (size_t)atomic_load(&g_inuse), (size_t)atomic_load(&g_usable), (size_t)atomic_load(&g_mmap_inuse),
+        regions, nstacks, other_b, other_n);
+    for(size_t r=0;r<ntop;r++){
+        const SnapEnt* e = &g_snap_tab[g_snap_top[r]];
+        snap_printf(fd, "stack #%zu bytes=%zu blocks=%zu kinds=", r, e->bytes, e->blocks);
+        const char* sep = "";
+        for(int k=K_MALLOC; k<=K_MMAP; k++) if(e->kinds & (1u << k)){ snap_printf(fd, "%s%s", sep, kind_name(k)); sep = ","; }
+        snap_printf(fd, "\n");
+        snap_flush(fd);
+        backtrace_symbols_fd(e->bt, e->bt_n, fd);
+    }
+    snap_flush(fd);
+    close(fd);
+    if(rename(tmp, path) != 0) unlink(tmp);
+    fprintf(stderr, "[leakhook] snapshot #%u (%s) total=%zu -> %s\n", g_snap_seq, why, total, path);
+    g_snap_seq++;
+}
+
+static uint64_t mono_ms(){
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+static void* watchdog(void*){
+    t_in_hook = 1;
+    size_t prev = atomic_load(&g_inuse) + atomic_load(&g_mmap_inuse);
+    size_t peak = prev;                                    // 采样到的真实峰值
+    size_t base = prev > (1u << 20) ? prev : (1u << 20);   // hwm 规则的基线：上次快照时的 peak
+    uint64_t prev_ms = mono_ms(), last_snap = 0, pend_ms = 0;
+    int have_snap = 0;
+    char why[96], pend[96], reason[128];
+    pend[0] = '\0';
+    for(;;){
+        struct timespec d = { (time_t)(g_wd.interval_ms / 1000), (long)(g_wd.interval_ms % 1000) * 1000000L };
+        nanosleep(&d, NULL);
+        size_t cur = atomic_load(&g_inuse) + atomic_load(&g_mmap_inuse);
+        uint64_t now = mono_ms();
+        if(cur > peak) peak = cur;
+        why[0] = '\0';
+        if(g_wd.bytes && cur >= g_wd.bytes && prev < g_wd.bytes)
+            snprintf(why, sizeof(why), "bytes>=%zu", g_wd.bytes);
+        else if(g_wd.rate && cur > prev && now > prev_ms &&
+                (double)(cur - prev) * 1000.0 / (double)(now - prev_ms) >= (double)g_wd.rate)
+            snprintf(why, sizeof(why), "rate=%.0fB/s", (double)(cur - prev) * 1000.0 / (double)(now - prev_ms));
+        else if(g_wd.hwm_pct && (double)cur > (double)base * (1.0 + (double)g_wd.hwm_pct / 100.0))
+            snprintf(why, sizeof(why), "hwm+%zu%% (base=%zu)", g_wd.hwm_pct, base);
+        if(why[0] && !pend[0]){ memcpy(pend, why, sizeof(pend)); pend_ms = now; }   // 冷却期内先挂起，不丢
+        if(pend[0] && (!have_snap || now - last_snap >= g_wd.cooldown_ms)){
+            if(now > pend_ms) snprintf(reason, sizeof(reason), "%s deferred=%llums peak=%zu", pend, (unsigned long long)(now - pend_ms), peak);
+            else              snprintf(reason, sizeof(reason), "%s", pend);
+            take_snapshot(reason, cur);
+            have_snap = 1; last_snap = now; pend[0] = '\0';
+            if(peak > base) base = peak;
+        }
+        prev = cur; prev_ms = now;
+    }
+    return NULL;
+}
+static void start_watchdog(){
+    g_wd.bytes = env_size("LEAKHOOK_WD_BYTES", 0);
+    g_wd.rate = env_size("LEAKHOOK_WD_RATE", 0);
+    g_wd.hwm_pct = env_pct("LEAKHOOK_WD_HWM_PCT");
+    if(!g_wd.bytes && !g_wd.rate && !g_wd.hwm_pct) return;
+    g_wd.interval_ms = env_size("LEAKHOOK_WD_MS", 200);
+    g_wd.cooldown_ms = env_size("LEAKHOOK_WD_COOLDOWN_MS", 5000);
+    g_wd.keep = env_size("LEAKHOOK_SNAP_KEEP", 8);
+    g_wd.top = env_size("LEAKHOOK_SNAP_TOP", 50);
+    if(!g_wd.interval_ms) g_wd.interval_ms = 1;
+    if(!g_wd.keep) g_wd.keep = 1;
+    if(!g_wd.top) g_wd.top = 1;
+    if(g_wd.top > SNAP_TOP_MAX) g_wd.top = SNAP_TOP_MAX;
+    const char* dir = getenv("LEAKHOOK_SNAP_DIR");
+    snprintf(g_wd.dir, sizeof(g_wd.dir), "%s", dir && *dir ? dir : ".");
+
+    g_snap_tab = scratch(SNAP_SLOTS * sizeof(SnapEnt));
+    g_snap_top = scratch(SNAP_TOP_MAX * sizeof(uint32_t));
+    g_snap_buf = scratch(SNAP_BUF);
+    if(!g_snap_tab || !g_snap_top || !g_snap_buf){ fprintf(stderr, "[leakhook] watchdog: mmap failed\n"); return; }
+    int fd = open("/dev/null", O_WRONLY);      // 预热 libgcc 的 unwinder，之后 backtrace_symbols_fd 不再加载
+    if(fd >= 0){ void* bt[2]; backtrace_symbols_fd(bt, backtrace(bt, 2), fd); close(fd); }
+    pthread_t th;
+    if(pthread_create(&th, NULL, watchdog, NULL) == 0) pthread_detach(th);
 }
 
 static void on_sigusr1(int){ dump_report(); }
 static __attribute__((constructor)) void hook_sig(){
     struct sigaction sa={0}; sa.sa_handler=on_sigusr1; sigaction(SIGUSR1,&sa,NULL);
+    if(syscall(SYS_gettid) == getpid()) g_main_tp = (uintptr_t)pthread_self();
+    hook_ready();
+    // LEAKHOOK_LEAK_CHECK=1：kill -USR2 <pid> 在后台线程做一次可达性扫描；未设置时不碰 SIGUSR2
+    const char* lc = getenv("LEAKHOOK_LEAK_CHECK");
+    if(lc && atoi(lc) > 0){
+        sem_init(&g_scan_sem, 0, 0);
+        pthread_t th;
+        if(pthread_create(&th, NULL, scan_service, NULL) == 0){
+            pthread_detach(th);
+            struct sigaction sb={0}; sb.sa_handler=on_sigusr2; sigaction(SIGUSR2,&sb,NULL);
+        }
+    }
+    start_watchdog();
 }
@@ -0,0 +1,514 @@
+// mem_sampler.c  (gcc -O2 -o mem_sampler mem_sampler.c)
+// mem_watch.sh 的原生替代：不 fork，常驻 fd + 复用缓冲区 + pread 读取
+//   /proc/PID/status, /proc/PID/smaps_rollup (无则只在 --smaps-every 的完整扫描轮读 smaps), /proc/meminfo, /proc/slabinfo
+// 逐映射 ΔRss 在内存中对比上一轮（不再写 SMAPS_SNAP_DIR 临时文件），
+// 每次采样追加一条定长二进制记录到环形日志；--dump 可导出 CSV。
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ---- 日志格式：mws_hdr/mws_rec 与 memhook_rss_fuse 共用一份定义 ---- */
+#include "../memhook_toolkit/lib/memhook_format.h"
+
+/* ---- 常驻 /proc 文件：fd 与缓冲区跨采样复用 ---- */
+typedef struct {
+    int fd;
+    char* buf;
+    size_t cap, len;
+} pfile;
+
+static int pf_open(pfile* f, const char* path){
+    f->fd = open(path, O_RDONLY|O_CLOEXEC);
+    f->len = 0;
+    return f->fd >= 0;
+}
+static void pf_close(pfile* f){
+    if(f->fd >= 0) close(f->fd);
+    f->fd = -1; f->len = 0;
+}
+/* 从 offset 0 整体 pread；失败/进程消失返回 0 */
+static int pf_read(pfile* f){
+    if(f->fd < 0) return 0;
+    size_t off = 0;
+    for(;;){
+        if(f->cap - off < 4096){
+            size_t nc = f->cap ? f->cap*2 : 16384;
+            char* nb = realloc(f->buf, nc);
+            if(!nb) return 0;
+            f->buf = nb; f->cap = nc;
+        }
+        ssize_t n = pread(f->fd, f->buf + off, f->cap - off - 1, (off_t)off);
+        if(n < 0){ if(errno == EINTR) continue; f->len = 0; return 0; }
+        if(n == 0) break;
+        off += (size_t)n;
+    }
+    f->buf[off] = '\0'; f->len = off;
+    return off > 0;
+}
+
+/* 目标 exec 之后旧的 smaps fd 读不到内容（mm 已换）：重开一次再读 */
+static int pf_read_pid(pfile* f, pid_t pid, const char* name){
+    if(pf_read(f)) return 1;
+    char path[64];
+    pf_close(f);
+    snprintf(path, sizeof(path), "/proc/%d/%s", (int)pid, name);
+    return pf_open(f, path) && pf_read(f);
+}
+
+/* ---- 解析辅助 ---- */
+typedef struct { const char* key; size_t klen; uint64_t* dst; } kvspec;
+#define KV(k, d) { k, sizeof(k)-1, d }
+
+static uint64_t num_at(const char* p){
+    while(*p == ' ' || *p == '\t') p++;
+    return strtoull(p, NULL, 10);
+}
+/* "Key:   123 kB" 逐行匹配；keys 按文件内顺序给出时基本一次命中 */
+static void parse_kv(const char* buf, const kvspec* kv, int n){
+    const char* p = buf;
+    int hit = 0;
+    while(*p && hit < n){
+        const char* nl = strchr(p, '\n');
+        for(int i=0;i<n;i++){
+            if(!strncmp(p, kv[i].key, kv[i].klen)){ *kv[i].dst = num_at(p + kv[i].klen); hit++; break; }
+        }
+        if(!nl) break;
+        p = nl + 1;
+    }
+}
+
+static uint32_t fnv32(const char* s, size_t n){
+    uint32_t h = 2166136261u;
+    for(size_t i=0;i<n;i++){ h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+/* ---- 逐映射 Rss：prev/cur 两张表都按起始地址升序（smaps 本身有序），归并即可求 Δ ---- */
+typedef struct {
+    uint64_t start, end;
+    uint32_t name_h;
+    uint32_t rss_kb, size_kb;
+    uint16_t flags;
+    char     name[42];
+} mapent;
+
+typedef struct { mapent* a; size_t n, cap; } mapvec;
+
+static mapent* mv_push(mapvec* v){
+    if(v->n == v->cap){
+        size_t nc = v->cap ? v->cap*2 : 256;
+        mapent* na = realloc(v->a, nc*sizeof(*na));
+        if(!na) return NULL;
+        v->a = na; v->cap = nc;
+    }
+    return &v->a[v->n++];
+}
+
+static void top_map_insert(mws_rec* r, int* n, const mapent* e, int32_t delta, uint16_t extra){
+    if(delta <= 0) return;
+    if(*n == MWS_TOPMAP && r->map[MWS_TOPMAP-1].delta_kb >= delta) return;
+    int i = (*n < MWS_TOPMAP) ? (*n)++ : MWS_TOPMAP-1;
+    while(i > 0 && r->map[i-1].delta_kb < delta){ r->map[i] = r->map[i-1]; i--; }
+    mws_map* m = &r->map[i];
+    m->start = e->start; m->delta_kb = delta; m->rss_kb = e->rss_kb; m->size_kb = e->size_kb;
+    m->flags = e->flags | extra;
+    memcpy(m->name, e->name, sizeof(m->name));
+}
+
+/* smaps 头行： "start-end perms offset dev inode   path" */
+static void parse_map_hdr(const char* p, const char* eol, mapent* e){
+    char* q;
+    e->start = strtoull(p, &q, 16);
+    e->end = (*q == '-') ? strtoull(q+1, &q, 16) : e->start;
+    e->size_kb = (uint32_t)((e->end - e->start) >> 10);
+    e->rss_kb = 0;
+    e->flags = 0;
+    while(q < eol && *q == ' ') q++;
+    if(q + 1 < eol && q[1] == 'w') e->flags |= MWS_M_WRITE;
+    /* 跳过 perms/offset/dev/inode 四列 */
+    for(int col=0; col<4 && q<eol; col++){
+        while(q < eol && *q != ' ') q++;
+        while(q < eol && *q == ' ') q++;
+    }
+    const char* name = q;
+    size_t nlen = (size_t)(eol - q);
+    if(nlen == 0){ name = "[anon]"; nlen = 6; }
+    if(*name != '/') e->flags |= MWS_M_ANON;
+    e->name_h = fnv32(name, nlen);
+    /* 路径过长时保留尾部（文件名更有辨识度） */
+    size_t keep = nlen < sizeof(e->name)-1 ? nlen : sizeof(e->name)-1;
+    memcpy(e->name, name + (nlen - keep), keep);
+    e->name[keep] = '\0';
+}
+
+/* 扫描完整 smaps：填 cur，累加汇总，与 prev 归并得到 top ΔRss */
+static void scan_smaps(const char* buf, mapvec* prev, mapvec* cur, int baseline, mws_rec* r){
+    cur->n = 0;
+    uint64_t pss=0, pdirty=0, anon=0, swap=0;
+    mapent* e = NULL;
+    const char* p = buf;
+    while(*p){
+        const char* nl = strchr(p, '\n');
+        const char* eol = nl ? nl : p + strlen(p);
+        char c = *p;
+        if((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')){
+            e = mv_push(cur);
+            if(e) parse_map_hdr(p, eol, e);
+        }else if(e){
+            if(!strncmp(p, "Rss:", 4))                e->rss_kb = (uint32_t)num_at(p+4);
+            else if(!strncmp(p, "Pss:", 4))           pss    += num_at(p+4);
+            else if(!strncmp(p, "Private_Dirty:", 14)) pdirty += num_at(p+14);
+            else if(!strncmp(p, "Anonymous:", 10))    anon   += num_at(p+10);
+            else if(!strncmp(p, "Swap:", 5))          swap   += num_at(p+5);
+        }
+        if(!nl) break;
+        p = nl + 1;
+    }
+    r->pss = pss; r->priv_dirty = pdirty; r->anonymous = anon; r->swap = swap;
+    r->n_maps = (uint32_t)cur->n;
+    r->flags |= MWS_F_SMAPS;
+
+    if(baseline) return;
+    /* 匿名区向下扩展/相邻合并会改变起始地址：按地址区间重叠 + 同名匹配上一轮，
+       都不重叠才算新映射（mem_watch.sh 按 "addr path" join，这类增长会漏掉） */
+    int ntop = 0;
+    size_t j = 0;
+    for(size_t i=0;i<cur->n;i++){
+        const mapent* c = &cur->a[i];
+        while(j < prev->n && prev->a[j].end <= c->start) j++;
+        int64_t base = 0; int found = 0;
+        for(size_t k=j; k<prev->n && prev->a[k].start < c->end; k++){
+            if(prev->a[k].name_h == c->name_h){ base += prev->a[k].rss_kb; found = 1; }
+        }
+        if(found) top_map_insert(r, &ntop, c, (int32_t)((int64_t)c->rss_kb - base), 0);
+        else      top_map_insert(r, &ntop, c, (int32_t)c->rss_kb, MWS_M_NEW);
+    }
+}
+
+static void parse_slabinfo(const char* buf, mws_rec* r){
+    const char* p = buf;
+    int line = 0, ntop = 0;
+    uint64_t total = 0;
+    while(*p){
+        const char* nl = strchr(p, '\n');
+        if(line++ >= 2){
+            char name[28]; unsigned long long act=0, num=0, osz=0;
+            if(sscanf(p, "%27s %llu %llu %llu", name, &act, &num, &osz) == 4){
+                total += num * osz;
+                if(ntop < MWS_TOPSLAB || r->slab[MWS_TOPSLAB-1].objs < num){
+                    int i = (ntop < MWS_TOPSLAB) ? ntop++ : MWS_TOPSLAB-1;
+                    while(i > 0 && r->slab[i-1].objs < num){ r->slab[i] = r->slab[i-1]; i--; }
+                    memcpy(r->slab[i].name, name, sizeof(name));
+                    r->slab[i].objs = (uint32_t)num;
+                }
+            }
+        }
+        if(!nl) break;
+        p = nl + 1;
+    }
+    r->slab_kb = total >> 10;
+    r->flags |= MWS_F_SLAB;
+}
+
+/* ---- 进程定位：扫 /proc/N/comm，不再 fork pidof ---- */
+static pid_t find_pid(const char* pname){
+    DIR* d = opendir("/proc");
+    if(!d) return 0;
+    size_t plen = strlen(pname);
+    if(plen > 15) plen = 15;                 /* comm 最长 15 字符 */
+    pid_t best = 0;
+    struct dirent* de;
+    char path[300], comm[32];
+    while((de = readdir(d))){
+        if(!isdigit((unsigned char)de->d_name[0])) continue;
+        snprintf(path, sizeof(path), "/proc/%s/comm", de->d_name);
+        int fd = open(path, O_RDONLY|O_CLOEXEC);
+        if(fd < 0) continue;
+        ssize_t n = read(fd, comm, sizeof(comm)-1);
+        close(fd);
+        if(n <= 0) continue;
+        comm[n] = '\0';
+        if(comm[n-1] == '\n') comm[--n] = '\0';
+        if((size_t)n == plen && !strncmp(comm, pname, plen)){
+            pid_t pid = (pid_t)atoi(de->d_name);
+            if(pid > best) best = pid;       /* 多实例取最新，与 pidof 首项一致 */
+        }
+    }
+    closedir(d);
+    return best;
+}
+
+/* ---- 环形日志 ---- */
+typedef struct {
+    int fd;
+    mws_hdr h;
+} ringlog;
+
+static int ring_open(ringlog* rl, const char* path, uint32_t slots, uint64_t interval_us, const char* pname, int force){
+    rl->fd = open(path, O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+    if(rl->fd < 0){ perror("open log"); return 0; }
+    mws_hdr h;
+    memset(&h, 0, sizeof(h));
+    /* 已有同格式日志：续写（保留历史），采样间隔以本次为准 */
+    if(pread(rl->fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) && h.magic == MWS_MAGIC &&
+       h.version == MWS_VERSION && h.rec_size == sizeof(mws_rec) && h.slots == slots){
+        rl->h = h;
+        rl->h.interval_us = interval_us;
+        if(pwrite(rl->fd, &rl->h.interval_us, sizeof(rl->h.interval_us), offsetof(mws_hdr, interval_us))
+           != (ssize_t)sizeof(rl->h.interval_us)){
+            perror("update log header"); close(rl->fd); return 0;
+        }
+        return 1;
+    }
+    /* 其余非空文件（槽位数/版本不同的日志，或根本不是日志）：不加 --force 不清空 */
+    struct stat st;
+    if(!force && fstat(rl->fd, &st) == 0 && st.st_size > 0){
+        if(h.magic == MWS_MAGIC)
+            fprintf(stderr, "[err] %s: existing log has version=%u slots=%u (want version=%u slots=%u); "
+                            "use --force to overwrite\n", path, h.version, h.slots, MWS_VERSION, slots);
+        else
+            fprintf(stderr, "[err] %s: not a mem_sampler log; use --force to overwrite\n", path);
+        close(rl->fd); return 0;
+    }
+    memset(&rl->h, 0, sizeof(rl->h));
+    rl->h.magic = MWS_MAGIC; rl->h.version = MWS_VERSION;
+    rl->h.rec_size = sizeof(mws_rec); rl->h.slots = slots;
+    rl->h.interval_us = interval_us;
+    struct timespec ts; clock_gettime(CLOCK_REALTIME, &ts);
+    rl->h.start_wall_ns = (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+    snprintf(rl->h.pname, sizeof(rl->h.pname), "%s", pname);
+    if(ftruncate(rl->fd, 0) != 0 ||
+       pwrite(rl->fd, &rl->h, sizeof(rl->h), 0) != (ssize_t)sizeof(rl->h)){
+        perror("init log"); close(rl->fd); return 0;
+    }
+    return 1;
+}
+
+/* 写失败（磁盘满/卡被拔）返回 0，由调用方退出，避免 seq 与记录错位 */
+static int ring_append(ringlog* rl, mws_rec* r){
+    r->seq = rl->h.seq;
+    off_t off = (off_t)sizeof(mws_hdr) + (off_t)(rl->h.seq % rl->h.slots) * (off_t)sizeof(mws_rec);
+    if(pwrite(rl->fd, r, sizeof(*r), off) != (ssize_t)sizeof(*r)){ perror("write log record"); return 0; }
+    rl->h.seq++;
+    /* 记录先落盘、再推进 seq，读者不会看到半条 */
+    if(pwrite(rl->fd, &rl->h.seq, sizeof(rl->h.seq), offsetof(mws_hdr, seq)) != (ssize_t)sizeof(rl->h.seq)){
+        perror("write log header"); return 0;
+    }
+    return 1;
+}
+
+/* ---- --dump: 按时间顺序导出 CSV ---- */
+static int dump_log(const char* path){
+    int fd = open(path, O_RDONLY|O_CLOEXEC);
+    if(fd < 0){ perror("open log"); return 2; }
+    mws_hdr h;
+    if(pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || h.magic != MWS_MAGIC){
+        fprintf(stderr, "[err] %s: not a mem_sampler log\n", path);
+        close(fd); return 2;
+    }
+    if(h.version != MWS_VERSION || h.rec_size != sizeof(mws_rec) || h.slots == 0){
+        fprintf(stderr, "[err] %s: unsupported log (version=%u rec_size=%u slots=%u)\n", path, h.version, h.rec_size, h.slots);
+        close(fd); return 2;
+    }
+    uint64_t n = h.seq < h.slots ? h.seq : h.slots;
+    uint64_t first = h.seq - n;
+    printf("seq,ts_ns,wall_ns,pid,threads,flags,vm_size_kb,vm_rss_kb,rss_anon_kb,rss_file_kb,rss_shmem_kb,"
+           "pss_kb,private_dirty_kb,anonymous_kb,swap_kb,mem_total_kb,mem_free_kb,mem_avail_kb,buffers_kb,"
+           "cached_kb,sreclaimable_kb,shmem_kb,slab_kb,top_slab,top_delta_rss\n");
+    mws_rec r;
+    for(uint64_t s=first; s<h.seq; s++){
+        off_t off = (off_t)sizeof(mws_hdr) + (off_t)(s % h.slots) * (off_t)sizeof(mws_rec);
+        if(pread(fd, &r, sizeof(r), off) != (ssize_t)sizeof(r)) break;
+        printf("%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%u,%u,0x%02x,"
+               "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ","
+               "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ","
+               "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+               r.seq, r.ts_ns, r.wall_ns, r.pid, r.threads, r.flags,
+               r.vm_size, r.vm_rss, r.rss_anon, r.rss_file, r.rss_shmem,
+               r.pss, r.priv_dirty, r.anonymous, r.swap,
+               r.mem_total, r.mem_free, r.mem_avail, r.buffers, r.cached, r.sreclaim, r.shmem, r.slab_kb);
+        /* 列表字段用 ';' 分隔，避免与 CSV 逗号冲突 */
+        for(int i=0;i<MWS_TOPSLAB && r.slab[i].name[0];i++)
+            printf("%s%.*s:%u", i?";":"", (int)sizeof(r.slab[i].name), r.slab[i].name, r.slab[i].objs);
+        putchar(',');
+        for(int i=0;i<MWS_TOPMAP && r.map[i].delta_kb>0;i++)
+            printf("%s%+d:%.*s%s", i?";":"", r.map[i].delta_kb, (int)sizeof(r.map[i].name), r.map[i].name,
+                   (r.map[i].flags & MWS_M_NEW) ? "(new)" : "");
+        putchar('\n');
+    }
+    close(fd);
+    return 0;
+}
+
+/* ---- main loop ---- */
+static volatile sig_atomic_t g_stop = 0;
+static void on_stop(int sig){ (void)sig; g_stop = 1; }
+
+static uint64_t now_ns(clockid_t c){
+    struct timespec ts; clock_gettime(c, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void usage(const char* prog){
+    fprintf(stderr,
+        "Usage: %s [process_name | -p PID] [interval_sec] [--lite] [options]\n"
+        "       %s --dump LOG > samples.csv\n"
+        "  process_name     default \"cardv\"\n"
+        "  interval_sec     default 30, fractional allowed (e.g. 0.2)\n"
+        "  --lite           skip per-mapping dRss (smaps_rollup only; status only without it)\n"
+        "  -p PID           track PID directly; takes the place of process_name\n"
+        "  --log PATH       ring log (env MEM_SAMPLER_LOG, default /mnt/mmc/mem_watch.bin)\n"
+        "  --slots N        ring capacity in samples (default 4096, %zuB each)\n"
+        "  --force          overwrite an existing log with a different slot count/version\n"
+        "  --smaps-every N  full smaps dRss scan every N samples (default 1); samples in between\n"
+        "                   read smaps_rollup, or only status on kernels without it\n"
+        "  --count N        exit after N samples (default 0 = forever)\n",
+        prog, prog, sizeof(mws_rec));
+}
+
+int main(int argc, char** argv){
+    const char* pname = "cardv";
+    double interval = 30.0;
+    int lite = 0, npos = 0, force = 0;
+    pid_t fixed_pid = 0;
+    char pid_name[24];
+    const char* logpath = getenv("MEM_SAMPLER_LOG");
+    if(!logpath || !*logpath) logpath = "/mnt/mmc/mem_watch.bin";
+    unsigned long slots = 4096, smaps_every = 1, count = 0;
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--dump") && i+1<argc) return dump_log(argv[i+1]);
+        if(!strcmp(argv[i],"--lite")){ lite = 1; continue; }
+        if(!strcmp(argv[i],"-p") && i+1<argc){
+            /* -p 占 process_name 的位置：其后第一个位置参数就是 interval */
+            if(npos != 0){ fprintf(stderr, "[err] -p PID replaces process_name; give one or the other\n"); return 1; }
+            fixed_pid = (pid_t)atoi(argv[++i]);
+            if(fixed_pid <= 0){ usage(argv[0]); return 1; }
+            snprintf(pid_name, sizeof(pid_name), "pid:%d", (int)fixed_pid);
+            pname = pid_name; npos = 1;
+            continue;
+        }
+        if(!strcmp(argv[i],"--force")){ force = 1; continue; }
+        if(!strcmp(argv[i],"--log") && i+1<argc){ logpath = argv[++i]; continue; }
+        if(!strcmp(argv[i],"--slots") && i+1<argc){ slots = strtoul(argv[++i],NULL,10); continue; }
+        if(!strcmp(argv[i],"--smaps-every") && i+1<argc){ smaps_every = strtoul(argv[++i],NULL,10); continue; }
+        if(!strcmp(argv[i],"--count") && i+1<argc){ count = strtoul(argv[++i],NULL,10); continue; }
+        if(argv[i][0] != '-' && npos == 0){ pname = argv[i]; npos++; continue; }
+        if(argv[i][0] != '-' && npos == 1){ interval = strtod(argv[i], NULL); npos++; continue; }
+        usage(argv[0]); return 1;
+    }
+    if(interval <= 0.0 || slots == 0){ usage(argv[0]); return 1; }
+    if(smaps_every == 0) smaps_every = 1;
+
+    uint64_t step_ns = (uint64_t)(interval * 1e9);
+    ringlog rl;
+    if(!ring_open(&rl, logpath, (uint32_t)slots, step_ns/1000, pname, force)) return 2;
+
+    struct sigaction sa = {0};
+    sa.sa_handler = on_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    pfile f_status = {-1,0,0,0}, f_rollup = {-1,0,0,0}, f_smaps = {-1,0,0,0}, f_meminfo = {-1,0,0,0}, f_slab = {-1,0,0,0};
+    pf_open(&f_meminfo, "/proc/meminfo");
+    pf_open(&f_slab, "/proc/slabinfo");            /* 通常需要 root；不可读则跳过 */
+    mapvec prev = {0}, cur = {0};
+    pid_t pid = 0;
+    int have_base = 0, has_rollup = 0;
+    uint64_t tick = 0;
+    int rc = 0;
+    mws_rec r;
+
+    fprintf(stderr, "[mem_sampler] process='%s' interval=%.3fs lite=%d log=%s slots=%lu\n",
+            pname, interval, lite, logpath, slots);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(!g_stop){
+        memset(&r, 0, sizeof(r));
+        r.ts_ns = now_ns(CLOCK_MONOTONIC);
+        r.wall_ns = now_ns(CLOCK_REALTIME);
+
+        if(!pid){
+            pid = fixed_pid ? fixed_pid : find_pid(pname);
+            if(pid){
+                char path[64];
+                snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);       pf_open(&f_status, path);
+                snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid); has_rollup = pf_open(&f_rollup, path);
+                snprintf(path, sizeof(path), "/proc/%d/smaps", (int)pid);        pf_open(&f_smaps, path);
+                prev.n = 0; have_base = 0;
+                r.flags |= MWS_F_NEWPID;
+                fprintf(stderr, "[mem_sampler] tracking pid %d\n", (int)pid);
+            }
+        }
+
+        if(pid && pf_read(&f_status)){
+            uint64_t thr = 0;
+            const kvspec kv[] = {
+                KV("VmSize:", &r.vm_size), KV("VmRSS:", &r.vm_rss), KV("RssAnon:", &r.rss_anon),
+                KV("RssFile:", &r.rss_file), KV("RssShmem:", &r.rss_shmem), KV("Threads:", &thr),
+            };
+            parse_kv(f_status.buf, kv, (int)(sizeof(kv)/sizeof(kv[0])));
+            r.pid = (uint32_t)pid; r.threads = (uint32_t)thr;
+            r.flags |= MWS_F_PROC;
+
+            int full = !lite && (tick % smaps_every == 0);
+            if(!full && has_rollup && pf_read_pid(&f_rollup, pid, "smaps_rollup")){
+                const kvspec kv2[] = {
+                    KV("Pss:", &r.pss), KV("Private_Dirty:", &r.priv_dirty),
+                    KV("Anonymous:", &r.anonymous), KV("Swap:", &r.swap),
+                };
+                parse_kv(f_rollup.buf, kv2, (int)(sizeof(kv2)/sizeof(kv2[0])));
+                r.flags |= MWS_F_ROLLUP;
+            }else if(full && pf_read_pid(&f_smaps, pid, "smaps")){
+                /* 完整 smaps：算 Δ，同时给出汇总。老内核无 smaps_rollup 时两次完整扫描之间只有 status 字段，
+                 * 不能每轮都退回完整 smaps，否则 --smaps-every 限不住开销 */
+                scan_smaps(f_smaps.buf, &prev, &cur, !have_base, &r);
+                mapvec t = prev; prev = cur; cur = t;
+                have_base = 1;
+            }
+        }else if(pid){
+            /* 进程退出/重启：关掉旧 fd，下轮重新定位 */
+            fprintf(stderr, "[mem_sampler] pid %d gone\n", (int)pid);
+            pf_close(&f_status); pf_close(&f_rollup); pf_close(&f_smaps);
+            pid = 0;
+        }
+
+        if(pf_read(&f_meminfo)){
+            const kvspec kv[] = {
+                KV("MemTotal:", &r.mem_total), KV("MemFree:", &r.mem_free), KV("MemAvailable:", &r.mem_avail),
+                KV("Buffers:", &r.buffers), KV("Cached:", &r.cached), KV("Shmem:", &r.shmem),
+                KV("SReclaimable:", &r.sreclaim),
+            };
+            parse_kv(f_meminfo.buf, kv, (int)(sizeof(kv)/sizeof(kv[0])));
+        }
+        if(pf_read(&f_slab)) parse_slabinfo(f_slab.buf, &r);
+
+        if(!ring_append(&rl, &r)){ rc = 2; break; }
+        tick++;
+        if(count && tick >= count) break;
+
+        /* 绝对时间睡眠，采样本身的耗时不会累积漂移 */
+        uint64_t t = (uint64_t)next.tv_sec*1000000000ull + (uint64_t)next.tv_nsec + step_ns;
+        next.tv_sec = (time_t)(t / 1000000000ull); next.tv_nsec = (long)(t % 1000000000ull);
+        while(!g_stop && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+    }
+
+    pf_close(&f_status); pf_close(&f_rollup); pf_close(&f_smaps); pf_close(&f_meminfo); pf_close(&f_slab);
+    free(f_status.buf); free(f_rollup.buf); free(f_smaps.buf); free(f_meminfo.buf); free(f_slab.buf);
+    free(prev.a); free(cur.a);
+    close(rl.fd);
+    return rc;
+}
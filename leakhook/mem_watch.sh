@@ -9,6 +9,8 @@
 # Env:
 #   MEM_WATCH_LOG=/path/to/log         (default: /tmp/mem_watch.log)
 #   SMAPS_SNAP_DIR=/path/for/snapshots (default: /tmp)
+#
+# 亚秒级/长期采样请用原生版 mem_sampler.c（不 fork，二进制环形日志，--dump 导出 CSV）
 
 PNAME="${1:-cardv}"
 INTERVAL="${2:-30}"
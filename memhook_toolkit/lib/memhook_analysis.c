@@ -0,0 +1,434 @@
+// lib/memhook_analysis.c - libmemhook_analysis 实现
+// 单遍流式重放：在存块用开地址哈希（backward-shift 删除），tid/调用点统计也是哈希，
+// 在存曲线边读边抽样（缓冲满则相邻两段合并、取较大者），内存与在存块数 + 抽样点数成正比，与记录数无关。
+
+#define _POSIX_C_SOURCE 200809L
+#include "memhook_analysis.h"
+#include "memhook_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+
+static uint64_t hmix(uint64_t x){ x ^= x>>33; x*=0xff51afd7ed558ccdULL; x^=x>>33; x*=0xc4ceb9fe1a85ec53ULL; x^=x>>33; return x; }
+
+/* ---- 在存块：ptr -> {size, tid, ra, ts, wall} ----
+ * 与 memhook_dump 同口径：同一地址重复分配（丢了 free）时两块都算在存，free 先摘最近的一块；
+ * 较早的块压在 dup 链上，极少出现。 */
+typedef struct LiveDup { uint64_t size, ra, ts_ns, wall_ns; uint32_t tid; struct LiveDup* next; } LiveDup;
+typedef struct { uint64_t ptr, size, ra, ts_ns, wall_ns; uint32_t tid, used; LiveDup* dup; } LiveEnt;
+typedef struct { LiveEnt* a; size_t cap, cnt, blocks; } LiveMap;   /* cnt：占用槽位；blocks：含 dup 的块数 */
+
+static LiveEnt* live_slot(LiveMap* m, uint64_t key, int* found){
+    size_t mask=m->cap-1, i=(size_t)hmix(key)&mask;
+    while(m->a[i].used && m->a[i].ptr!=key) i=(i+1)&mask;
+    *found=m->a[i].used;
+    return &m->a[i];
+}
+static int live_grow(LiveMap* m){
+    size_t ncap=m->cap? m->cap*2 : 1<<16;
+    LiveMap n={ calloc(ncap,sizeof(LiveEnt)), ncap, 0, m->blocks };
+    if(!n.a) return 0;
+    for(size_t i=0;i<m->cap;i++) if(m->a[i].used){ int f; *live_slot(&n,m->a[i].ptr,&f)=m->a[i]; n.cnt++; }
+    free(m->a); *m=n;
+    return 1;
+}
+static int live_push(LiveMap* m, uint64_t ptr, uint64_t size, uint64_t ra, uint64_t ts, uint64_t wall, uint32_t tid){
+    if((m->cnt+1)*2 > m->cap && !live_grow(m)) return 0;
+    int found; LiveEnt* e=live_slot(m,ptr,&found);
+    LiveDup* d=NULL;
+    if(found){
+        if(!(d=malloc(sizeof(*d)))) return 0;
+        *d=(LiveDup){ e->size, e->ra, e->ts_ns, e->wall_ns, e->tid, e->dup };
+    }else m->cnt++;
+    *e=(LiveEnt){ ptr, size, ra, ts, wall, tid, 1, d };
+    m->blocks++;
+    return 1;
+}
+/* 摘下 key 最近分配的一块 */
+static int live_pop(LiveMap* m, uint64_t key, LiveEnt* out){
+    if(!m->cnt) return 0;
+    int found; LiveEnt* e=live_slot(m,key,&found);
+    if(!found) return 0;
+    *out=*e; m->blocks--;
+    if(e->dup){
+        LiveDup* d=e->dup;
+        e->size=d->size; e->ra=d->ra; e->ts_ns=d->ts_ns; e->wall_ns=d->wall_ns; e->tid=d->tid; e->dup=d->next;
+        free(d);
+        return 1;
+    }
+    size_t mask=m->cap-1, i=(size_t)(e-m->a), j=i;
+    for(;;){
+        j=(j+1)&mask;
+        if(!m->a[j].used) break;
+        size_t home=(size_t)hmix(m->a[j].ptr)&mask;
+        if(((j-home)&mask) < ((j-i)&mask)) continue;
+        m->a[i]=m->a[j]; i=j;
+    }
+    m->a[i].used=0; m->a[i].dup=NULL; m->cnt--;
+    return 1;
+}
+
+/* ---- tid / 调用点统计：key -> {cur, peak, 峰值时刻} ---- */
+typedef struct { uint64_t key, cur, peak, pts, pwall; int64_t pidx; uint32_t used, pad; } Stat;
+typedef struct { Stat* a; size_t cap, cnt; } StatMap;
+
+static Stat* stat_get(StatMap* m, uint64_t key){
+    if((m->cnt+1)*2 > m->cap){
+        size_t ncap=m->cap? m->cap*2 : 1024;
+        Stat* na=calloc(ncap,sizeof(Stat));
+        if(!na) return NULL;
+        for(size_t i=0;i<m->cap;i++) if(m->a[i].used){
+            size_t j=(size_t)hmix(m->a[i].key)&(ncap-1);
+            while(na[j].used) j=(j+1)&(ncap-1);
+            na[j]=m->a[i];
+        }
+        free(m->a); m->a=na; m->cap=ncap;
+    }
+    size_t mask=m->cap-1, i=(size_t)hmix(key)&mask;
+    while(m->a[i].used && m->a[i].key!=key) i=(i+1)&mask;
+    if(!m->a[i].used){ m->a[i]=(Stat){ .key=key, .pidx=-1, .used=1 }; m->cnt++; }
+    return &m->a[i];
+}
+static Stat* stat_find(StatMap* m, uint64_t key){
+    if(!m->cnt) return NULL;
+    size_t mask=m->cap-1, i=(size_t)hmix(key)&mask;
+    while(m->a[i].used){ if(m->a[i].key==key) return &m->a[i]; i=(i+1)&mask; }
+    return NULL;
+}
+
+/* ---- 列式结果 ---- */
+typedef struct {
+    size_t n;
+    uint64_t *key, *peak, *pts, *pwall; int64_t* pidx; char* pwt;
+} PeakCols;
+
+struct mha_ctx {
+    mha_opts opt;
+    char err[256];
+    int finished;
+
+    LiveMap live;
+    StatMap tids, sites;
+    uint64_t cur, records;
+    mha_overview ov;
+
+    /* 在存曲线抽样：每 stride 行一段，段内取在存最大的行 */
+    size_t s_n, s_cap; uint64_t s_stride, s_inseg;
+    int64_t* s_idx; uint64_t *s_ts, *s_wall, *s_val;
+    int64_t seg_idx; uint64_t seg_ts, seg_wall, seg_val;
+    int64_t last_idx; uint64_t last_ts, last_wall, last_val;
+    char* s_wt;
+
+    PeakCols pt, ps;
+    struct { size_t n; uint64_t *ptr, *size, *ra, *ts, *wall; uint32_t* tid; char* wt; } lv;
+};
+
+static int fail(mha_ctx* c, const char* fmt, ...){
+    va_list ap; va_start(ap,fmt); vsnprintf(c->err,sizeof(c->err),fmt,ap); va_end(ap);
+    return -1;
+}
+
+/* 与 memhook_dump 的 wall_time 列一致："YYYY-MM-DD HH:MM:SS.mmm"；无则 "-" */
+static void fmt_wall(uint64_t wall_ns, char out[MHA_WALL_LEN]){
+    if(!wall_ns){ strcpy(out,"-"); return; }
+    time_t sec=(time_t)(wall_ns/1000000000ull);
+    unsigned long ms=(unsigned long)((wall_ns%1000000000ull)/1000000ull);
+    struct tm tmv; localtime_r(&sec,&tmv);
+    size_t len=strftime(out,MHA_WALL_LEN,"%Y-%m-%d %H:%M:%S",&tmv);
+    snprintf(out+len,MHA_WALL_LEN-len,".%03lu",ms);
+}
+
+uint32_t mha_abi_version(void){ return MHA_ABI_VERSION; }
+
+mha_ctx* mha_open(const mha_opts* opts){
+    mha_ctx* c=calloc(1,sizeof(*c));
+    if(!c) return NULL;
+    if(opts) c->opt=*opts; else c->opt.downsample=400;
+    c->ov.peak_idx=-1; c->ov.cross_idx=-1;
+    c->s_stride=1; c->last_idx=-1;
+    if(!live_grow(&c->live)){ free(c); return NULL; }
+    return c;
+}
+
+void mha_close(mha_ctx* c){
+    if(!c) return;
+    for(size_t i=0;i<c->live.cap;i++) for(LiveDup* d=c->live.a[i].used? c->live.a[i].dup:NULL; d; ){ LiveDup* nx=d->next; free(d); d=nx; }
+    free(c->live.a); free(c->tids.a); free(c->sites.a);
+    free(c->s_idx); free(c->s_ts); free(c->s_wall); free(c->s_val); free(c->s_wt);
+    PeakCols* pc[2]={&c->pt,&c->ps};
+    for(int i=0;i<2;i++){ free(pc[i]->key); free(pc[i]->peak); free(pc[i]->pts); free(pc[i]->pwall); free(pc[i]->pidx); free(pc[i]->pwt); }
+    free(c->lv.ptr); free(c->lv.size); free(c->lv.ra); free(c->lv.ts); free(c->lv.wall); free(c->lv.tid); free(c->lv.wt);
+    free(c);
+}
+
+const char* mha_last_error(const mha_ctx* c){ return c? c->err : "null context"; }
+
+/* ---- 抽样缓冲 ---- */
+static int series_append(mha_ctx* c, int64_t idx, uint64_t ts, uint64_t wall, uint64_t val){
+    if(c->s_n==c->s_cap){
+        size_t ncap = c->s_cap? c->s_cap*2 : (c->opt.downsample? (size_t)c->opt.downsample*2 : 4096);
+        int64_t* a=realloc(c->s_idx,ncap*sizeof(*a)); if(!a) return 0; c->s_idx=a;
+        uint64_t* b=realloc(c->s_ts,ncap*sizeof(*b));  if(!b) return 0; c->s_ts=b;
+        b=realloc(c->s_wall,ncap*sizeof(*b));          if(!b) return 0; c->s_wall=b;
+        b=realloc(c->s_val,ncap*sizeof(*b));           if(!b) return 0; c->s_val=b;
+        c->s_cap=ncap;
+    }
+    c->s_idx[c->s_n]=idx; c->s_ts[c->s_n]=ts; c->s_wall[c->s_n]=wall; c->s_val[c->s_n]=val; c->s_n++;
+    return 1;
+}
+/* 相邻两段合并，保留在存更大的一点（同值取较早者），点数减半 */
+static void series_halve(mha_ctx* c, size_t upto){
+    size_t k=0;
+    for(size_t i=0;i<upto;i+=2){
+        size_t j = (i+1<upto && c->s_val[i+1]>c->s_val[i]) ? i+1 : i;
+        c->s_idx[k]=c->s_idx[j]; c->s_ts[k]=c->s_ts[j]; c->s_wall[k]=c->s_wall[j]; c->s_val[k]=c->s_val[j]; k++;
+    }
+    for(size_t i=upto;i<c->s_n;i++,k++){
+        c->s_idx[k]=c->s_idx[i]; c->s_ts[k]=c->s_ts[i]; c->s_wall[k]=c->s_wall[i]; c->s_val[k]=c->s_val[i];
+    }
+    c->s_n=k;
+}
+static int series_push(mha_ctx* c, int64_t idx, uint64_t ts, uint64_t wall, uint64_t val){
+    c->last_idx=idx; c->last_ts=ts; c->last_wall=wall; c->last_val=val;
+    if(!c->s_inseg || val>c->seg_val){ c->seg_idx=idx; c->seg_ts=ts; c->seg_wall=wall; c->seg_val=val; }
+    if(++c->s_inseg < c->s_stride) return 1;
+    c->s_inseg=0;
+    if(!series_append(c,c->seg_idx,c->seg_ts,c->seg_wall,c->seg_val)) return 0;
+    if(c->opt.downsample && c->s_n >= (size_t)c->opt.downsample*2){ series_halve(c,c->s_n); c->s_stride*=2; }
+    return 1;
+}
+
+/* ---- 重放 ---- */
+static int sub_stat(mha_ctx* c, StatMap* m, uint64_t key, uint64_t sz){
+    Stat* s=stat_find(m,key);
+    if(s) s->cur = s->cur>=sz ? s->cur-sz : 0;
+    return 1;
+}
+static int add_stat(StatMap* m, uint64_t key, uint64_t sz, int64_t idx, uint64_t ts, uint64_t wall){
+    Stat* s=stat_get(m,key);
+    if(!s) return 0;
+    s->cur+=sz;
+    if(s->cur>s->peak){ s->peak=s->cur; s->pidx=idx; s->pts=ts; s->pwall=wall; }
+    return 1;
+}
+static void release(mha_ctx* c, const LiveEnt* old){
+    c->cur = c->cur>=old->size ? c->cur-old->size : 0;
+    sub_stat(c,&c->tids,old->tid,old->size);
+    sub_stat(c,&c->sites,old->ra,old->size);
+}
+
+int mha_push(mha_ctx* c, int64_t idx, uint64_t ts, uint64_t wall, uint32_t tid,
+             int op, uint64_t ptr, uint64_t arg, uint64_t ra){
+    if(c->finished) return fail(c,"mha_push after mha_finish");
+    /* 与 memhook_dump 同口径：realloc 记作 (old,0)+(new,size)，ptr 在存即旧块（摘下），否则是新块 */
+    LiveEnt old;
+    int popped = (op==MHA_OP_FREE || op==MHA_OP_REALLOC) && live_pop(&c->live,ptr,&old);
+    if(popped) release(c,&old);
+    if(op==MHA_OP_MALLOC || op==MHA_OP_CALLOC || (op==MHA_OP_REALLOC && !popped)){
+        if(!live_push(&c->live,ptr,arg,ra,ts,wall,tid)) return fail(c,"out of memory (live map)");
+        c->cur+=arg;
+        if(!add_stat(&c->tids,tid,arg,idx,ts,wall) || !add_stat(&c->sites,ra,arg,idx,ts,wall))
+            return fail(c,"out of memory (stats)");
+    }
+    if(c->cur>c->ov.peak_live_bytes){
+        c->ov.peak_live_bytes=c->cur; c->ov.peak_idx=idx; c->ov.peak_ts_ns=ts; c->ov.peak_wall_ns=wall;
+    }
+    if(c->opt.approx_mem && !c->ov.has_cross && c->cur>=c->opt.approx_mem){
+        c->ov.has_cross=1; c->ov.cross_idx=idx; c->ov.cross_ts_ns=ts; c->ov.cross_wall_ns=wall; c->ov.cross_bytes=c->cur;
+    }
+    c->records++;
+    if(!series_push(c,idx,ts,wall,c->cur)) return fail(c,"out of memory (series)");
+    return 0;
+}
+
+uint64_t mha_live_bytes(const mha_ctx* c){ return c->cur; }
+
+/* ---- CSV 输入 ---- */
+static uint64_t parse_u64(const char* s, const char* e){
+    while(s<e && (*s==' '||*s=='\t')) s++;
+    uint64_t v=0;
+    if(e-s>2 && s[0]=='0' && (s[1]=='x'||s[1]=='X')){
+        for(s+=2;s<e;s++){
+            unsigned d;
+            if(*s>='0'&&*s<='9') d=(unsigned)(*s-'0');
+            else if((*s|0x20)>='a'&&(*s|0x20)<='f') d=(unsigned)((*s|0x20)-'a'+10);
+            else break;
+            v=v*16+d;
+        }
+        return v;
+    }
+    for(;s<e && *s>='0'&&*s<='9';s++) v=v*10+(uint64_t)(*s-'0');
+    return v;
+}
+static int op_code(const char* s, const char* e){
+    size_t n=(size_t)(e-s);
+    if(n==6 && !memcmp(s,"malloc",6)) return MHA_OP_MALLOC;
+    if(n==4 && !memcmp(s,"free",4)) return MHA_OP_FREE;
+    if(n==7 && !memcmp(s,"realloc",7)) return MHA_OP_REALLOC;
+    if(n==6 && !memcmp(s,"calloc",6)) return MHA_OP_CALLOC;
+    return -1;
+}
+
+enum { C_IDX, C_TS, C_WALL, C_TID, C_OP, C_PTR, C_ARG, C_RA, C_N };
+
+int mha_feed_csv(mha_ctx* c, const char* path){
+    FILE* f=fopen(path,"r");
+    if(!f) return fail(c,"open %s failed", path);
+    static const char* names[C_N]={"idx","ts_ns","wall_ns","tid","op","ptr","arg","retaddr"};
+    int col[C_N]; for(int k=0;k<C_N;k++) col[k]=-1;
+    char* line=NULL; size_t cap=0; ssize_t n=getline(&line,&cap,f);
+    if(n<=0){ free(line); fclose(f); return fail(c,"%s: empty csv", path); }
+    int ncol=0;
+    for(char* p=line;;ncol++){
+        char* q=p; while(*q && *q!=',' && *q!='\n' && *q!='\r') q++;
+        for(int k=0;k<C_N;k++) if((size_t)(q-p)==strlen(names[k]) && !memcmp(p,names[k],(size_t)(q-p))) col[k]=ncol;
+        if(*q!=','){ ncol++; break; }
+        p=q+1;
+    }
+    for(int k=0;k<C_N;k++) if(col[k]<0){ free(line); fclose(f); return fail(c,"%s: missing column: %s", path, names[k]); }
+
+    const char *fs[64], *fe[64];
+    int rc=0;
+    while((n=getline(&line,&cap,f))>0){
+        int nf=0; char* p=line;
+        while(nf<64){
+            char* q=p; while(*q && *q!=',' && *q!='\n' && *q!='\r') q++;
+            fs[nf]=p; fe[nf]=q; nf++;
+            if(*q!=',') break;
+            p=q+1;
+        }
+        if(nf<ncol) continue;                    /* 坏行：跳过 */
+        int op=op_code(fs[col[C_OP]],fe[col[C_OP]]);
+        if(mha_push(c,(int64_t)parse_u64(fs[col[C_IDX]],fe[col[C_IDX]]),
+                      parse_u64(fs[col[C_TS]],fe[col[C_TS]]), parse_u64(fs[col[C_WALL]],fe[col[C_WALL]]),
+                      (uint32_t)parse_u64(fs[col[C_TID]],fe[col[C_TID]]), op,
+                      parse_u64(fs[col[C_PTR]],fe[col[C_PTR]]), parse_u64(fs[col[C_ARG]],fe[col[C_ARG]]),
+                      parse_u64(fs[col[C_RA]],fe[col[C_RA]]))){ rc=-1; break; }
+    }
+    free(line); fclose(f);
+    return rc;
+}
+
+/* ---- .bin 输入（版本判断见 memhook_format.h 的 memhook_bin_is_v2） ---- */
+int mha_feed_bin(mha_ctx* c, const char* path){
+    FILE* f=fopen(path,"rb");
+    if(!f) return fail(c,"open %s failed", path);
+    fseek(f,0,SEEK_END); long sz=ftell(f); rewind(f);
+    int v2 = memhook_bin_is_v2(f, sz);
+    size_t rs = v2? sizeof(rec_v2) : sizeof(rec_v1);
+    enum { BATCH=4096 };
+    unsigned char* buf=malloc(BATCH*sizeof(rec_v2));
+    if(!buf){ fclose(f); return fail(c,"out of memory"); }
+    int64_t idx=(int64_t)c->records; size_t got; int rc=0;
+    while(!rc && (got=fread(buf,rs,BATCH,f))>0){
+        for(size_t i=0;i<got && !rc;i++,idx++){
+            rec_v2 r;
+            if(v2) memcpy(&r,buf+i*rs,sizeof(r));
+            else { rec_v1 a; memcpy(&a,buf+i*rs,sizeof(a)); r=(rec_v2){a.ts_ns,0,a.tid,a.op,a.pad,a.ptr,a.arg,a.retaddr}; }
+            rc=mha_push(c,idx,r.ts_ns,r.wall_ns,r.tid,r.op<4? r.op:-1,r.ptr,r.arg,r.retaddr);
+        }
+    }
+    free(buf); fclose(f);
+    return rc;
+}
+
+/* ---- 结束：生成列 ---- */
+static int cmp_stat_peak(const void* A, const void* B){
+    const Stat *a=A, *b=B;
+    if(a->peak!=b->peak) return a->peak<b->peak ? 1 : -1;
+    return (a->key>b->key)-(a->key<b->key);
+}
+static int build_peaks(StatMap* m, PeakCols* pc){
+    size_t n=m->cnt;
+    Stat* v=malloc((n? n:1)*sizeof(Stat));
+    pc->key=malloc((n? n:1)*8); pc->peak=malloc((n? n:1)*8); pc->pts=malloc((n? n:1)*8);
+    pc->pwall=malloc((n? n:1)*8); pc->pidx=malloc((n? n:1)*8); pc->pwt=malloc((n? n:1)*MHA_WALL_LEN);
+    if(!v || !pc->key || !pc->peak || !pc->pts || !pc->pwall || !pc->pidx || !pc->pwt){ free(v); return 0; }
+    size_t k=0;
+    for(size_t i=0;i<m->cap;i++) if(m->a[i].used) v[k++]=m->a[i];
+    qsort(v,n,sizeof(Stat),cmp_stat_peak);
+    for(size_t i=0;i<n;i++){
+        const Stat* s=&v[i];
+        pc->key[i]=s->key; pc->peak[i]=s->peak; pc->pidx[i]=s->pidx; pc->pts[i]=s->pts; pc->pwall[i]=s->pwall;
+        fmt_wall(s->pwall, pc->pwt+i*MHA_WALL_LEN);
+    }
+    pc->n=n; free(v);
+    return 1;
+}
+static int cmp_live_size(const void* A, const void* B){
+    const LiveEnt *a=A, *b=B;
+    if(a->size!=b->size) return a->size<b->size ? 1 : -1;
+    if(a->ptr!=b->ptr) return a->ptr>b->ptr ? 1 : -1;
+    return (a->ts_ns>b->ts_ns)-(a->ts_ns<b->ts_ns);
+}
+
+int mha_finish(mha_ctx* c){
+    if(c->finished) return 0;
+    c->finished=1;
+    /* 曲线：补上未满的段，压到 downsample 点以内，再补末点 */
+    if(c->s_inseg && !series_append(c,c->seg_idx,c->seg_ts,c->seg_wall,c->seg_val)) return fail(c,"out of memory (series)");
+    while(c->opt.downsample && c->s_n > c->opt.downsample) series_halve(c,c->s_n);
+    if(c->last_idx>=0 && (!c->s_n || c->s_idx[c->s_n-1]!=c->last_idx)
+       && !series_append(c,c->last_idx,c->last_ts,c->last_wall,c->last_val)) return fail(c,"out of memory (series)");
+    c->s_wt=malloc((c->s_n? c->s_n:1)*MHA_WALL_LEN);
+    if(!c->s_wt) return fail(c,"out of memory (series)");
+    for(size_t i=0;i<c->s_n;i++) fmt_wall(c->s_wall[i], c->s_wt+i*MHA_WALL_LEN);
+
+    if(!build_peaks(&c->tids,&c->pt) || !build_peaks(&c->sites,&c->ps)) return fail(c,"out of memory (peaks)");
+
+    size_t n=c->live.blocks, m=n? n:1;
+    LiveEnt* v=malloc(m*sizeof(LiveEnt));
+    c->lv.ptr=malloc(m*8); c->lv.size=malloc(m*8); c->lv.ra=malloc(m*8); c->lv.ts=malloc(m*8); c->lv.wall=malloc(m*8);
+    c->lv.tid=malloc(m*4); c->lv.wt=malloc(m*MHA_WALL_LEN);
+    if(!v || !c->lv.ptr || !c->lv.size || !c->lv.ra || !c->lv.ts || !c->lv.wall || !c->lv.tid || !c->lv.wt){
+        free(v); return fail(c,"out of memory (live blocks)");
+    }
+    size_t k=0; uint64_t bytes=0;
+    for(size_t i=0;i<c->live.cap;i++) if(c->live.a[i].used){
+        const LiveEnt* e=&c->live.a[i];
+        v[k++]=*e; bytes+=e->size;
+        for(const LiveDup* d=e->dup; d; d=d->next){
+            v[k++]=(LiveEnt){ e->ptr, d->size, d->ra, d->ts_ns, d->wall_ns, d->tid, 1, NULL };
+            bytes+=d->size;
+        }
+    }
+    qsort(v,n,sizeof(LiveEnt),cmp_live_size);
+    for(size_t i=0;i<n;i++){
+        const LiveEnt* e=&v[i];
+        c->lv.ptr[i]=e->ptr; c->lv.size[i]=e->size; c->lv.ra[i]=e->ra; c->lv.ts[i]=e->ts_ns; c->lv.wall[i]=e->wall_ns; c->lv.tid[i]=e->tid;
+        fmt_wall(e->wall_ns, c->lv.wt+i*MHA_WALL_LEN);
+    }
+    c->lv.n=n; free(v);
+
+    c->ov.records=c->records;
+    c->ov.end_live_blocks=n; c->ov.end_live_bytes=bytes;
+    fmt_wall(c->ov.peak_wall_ns, c->ov.peak_wall_time);
+    fmt_wall(c->ov.cross_wall_ns, c->ov.cross_wall_time);
+    return 0;
+}
+
+/* ---- 读取 ---- */
+int mha_overview_get(const mha_ctx* c, mha_overview* out){
+    if(!c->finished) return -1;
+    *out=c->ov; return 0;
+}
+int mha_series_get(const mha_ctx* c, mha_series* out){
+    if(!c->finished) return -1;
+    *out=(mha_series){ c->s_n, c->s_idx, c->s_ts, c->s_wall, c->s_val, c->s_wt };
+    return 0;
+}
+static void peaks_view(const PeakCols* pc, mha_peaks* out){
+    *out=(mha_peaks){ pc->n, pc->key, pc->peak, pc->pidx, pc->pts, pc->pwall, pc->pwt };
+}
+int mha_sites_get(const mha_ctx* c, mha_peaks* out){ if(!c->finished) return -1; peaks_view(&c->ps,out); return 0; }
+int mha_tids_get(const mha_ctx* c, mha_peaks* out){ if(!c->finished) return -1; peaks_view(&c->pt,out); return 0; }
+int mha_live_get(const mha_ctx* c, mha_live* out){
+    if(!c->finished) return -1;
+    *out=(mha_live){ c->lv.n, c->lv.ptr, c->lv.size, c->lv.ra, c->lv.ts, c->lv.wall, c->lv.tid, c->lv.wt };
+    return 0;
+}
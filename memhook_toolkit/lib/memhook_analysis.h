@@ -0,0 +1,105 @@
+// lib/memhook_analysis.h - libmemhook_analysis：memhook 事件重放/聚合引擎（稳定 C ABI）
+//
+// 用法：mha_open -> mha_feed_csv / mha_feed_bin / mha_push（可多次）-> mha_finish -> 各 *_get -> mha_close
+// 结果以列式数组给出（每列一段连续内存，生命周期到 mha_close 为止），
+// Python 可经 ctypes 直接映射成 numpy 数组，无需拷贝。
+//
+// ABI 约定：只追加不修改。结构体新增字段放末尾并提升 MHA_ABI_VERSION；调用方用 mha_abi_version() 校验。
+// 重放口径与 memhook_dump 一致：malloc/calloc 入账；free 摘下该 ptr 最近的一块；realloc 按 hook 的
+// (old,0)+(new,size) 两条记录处理，ptr 在存即旧块（摘下），否则登记为新块；同一 ptr 重复分配时各块都算在存。
+// wall_time 字段为定长 MHA_WALL_LEN 字节、NUL 结尾的串，由 wall_ns 按本地时区格式化（无 wall_ns 时为 "-"）。
+
+#ifndef MEMHOOK_ANALYSIS_H
+#define MEMHOOK_ANALYSIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MHA_ABI_VERSION  1
+#define MHA_WALL_LEN     32
+
+enum { MHA_OP_MALLOC=0, MHA_OP_FREE=1, MHA_OP_REALLOC=2, MHA_OP_CALLOC=3 };
+
+typedef struct mha_ctx mha_ctx;
+
+typedef struct {
+    uint64_t approx_mem;        /* >0：记录在存首次 >= 该值的时刻 */
+    uint32_t downsample;        /* 在存曲线最多保留的点数（每段取最大值，另加末点）；0 = 全部保留 */
+    uint32_t reserved;
+} mha_opts;
+
+typedef struct {
+    uint64_t records;
+    uint64_t peak_live_bytes;
+    int64_t  peak_idx;          /* 无分配时为 -1 */
+    uint64_t peak_ts_ns, peak_wall_ns;
+    uint64_t end_live_blocks, end_live_bytes;
+    int32_t  has_cross, pad;
+    int64_t  cross_idx;
+    uint64_t cross_ts_ns, cross_wall_ns, cross_bytes;
+    char     peak_wall_time[MHA_WALL_LEN];
+    char     cross_wall_time[MHA_WALL_LEN];
+} mha_overview;
+
+typedef struct {                /* 在存曲线（行后状态），按 idx 升序 */
+    size_t n;
+    const int64_t*  idx;
+    const uint64_t* ts_ns;
+    const uint64_t* wall_ns;
+    const uint64_t* live_bytes;
+    const char*     wall_time;  /* n * MHA_WALL_LEN */
+} mha_series;
+
+typedef struct {                /* 按 tid 或调用点(retaddr)的在存峰值，peak 降序 */
+    size_t n;
+    const uint64_t* key;
+    const uint64_t* peak_bytes;
+    const int64_t*  peak_idx;
+    const uint64_t* peak_ts_ns;
+    const uint64_t* peak_wall_ns;
+    const char*     peak_wall_time;
+} mha_peaks;
+
+typedef struct {                /* 结束时仍在存的块（同一 ptr 重复分配未释放的各算一块），size 降序 */
+    size_t n;
+    const uint64_t* ptr;
+    const uint64_t* size;
+    const uint64_t* ra;
+    const uint64_t* alloc_ts_ns;
+    const uint64_t* alloc_wall_ns;
+    const uint32_t* tid;
+    const char*     alloc_wall_time;
+} mha_live;
+
+uint32_t    mha_abi_version(void);
+
+/* opts 可为 NULL（downsample=400，不做 approx-mem） */
+mha_ctx*    mha_open(const mha_opts* opts);
+void        mha_close(mha_ctx* c);
+const char* mha_last_error(const mha_ctx* c);
+
+/* 成功返回 0，失败返回 -1（原因见 mha_last_error）；可依次喂多个文件 */
+int mha_feed_csv(mha_ctx* c, const char* path);          /* memhook_dump --csv 的输出 */
+int mha_feed_bin(mha_ctx* c, const char* path);          /* .bin v1(40B)/v2(48B) */
+int mha_push(mha_ctx* c, int64_t idx, uint64_t ts_ns, uint64_t wall_ns, uint32_t tid,
+             int op, uint64_t ptr, uint64_t arg, uint64_t ra);
+/* 到目前为止的在存字节；边喂边读（如按 wall_ns 与 RSS 采样对齐）时用 */
+uint64_t mha_live_bytes(const mha_ctx* c);
+
+/* 结束喂数据并生成各表；之后只能读取 */
+int mha_finish(mha_ctx* c);
+
+int mha_overview_get(const mha_ctx* c, mha_overview* out);
+int mha_series_get(const mha_ctx* c, mha_series* out);
+int mha_sites_get(const mha_ctx* c, mha_peaks* out);
+int mha_tids_get(const mha_ctx* c, mha_peaks* out);
+int mha_live_get(const mha_ctx* c, mha_live* out);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,140 @@
+// lib/memhook_format.h - 磁盘格式：memhook .bin 记录（v1/v2）与 mem_sampler 环形日志（MWS1）
+// 纯头文件：memhook_dump / libmemhook_analysis / memhook_rss_fuse / memhook_gen / leakhook/mem_sampler 共用，
+// 结构体与版本探测只在这里定义一份。
+#ifndef MEMHOOK_FORMAT_H
+#define MEMHOOK_FORMAT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* ================= memhook .bin ================= */
+/* 无文件头，定长记录首尾相接；op: 0=malloc 1=free 2=realloc 3=calloc */
+#pragma pack(push,1)
+typedef struct {                    /* v1: 40B, no wall_ns */
+    uint64_t ts_ns;
+    uint32_t tid;
+    uint16_t op;
+    uint16_t pad;
+    uint64_t ptr;
+    uint64_t arg;
+    uint64_t retaddr;
+} rec_v1;
+
+typedef struct {                    /* v2: 48B, with wall_ns */
+    uint64_t ts_ns;
+    uint64_t wall_ns;               /* NEW in v2 */
+    uint32_t tid;
+    uint16_t op;
+    uint16_t pad;
+    uint64_t ptr;
+    uint64_t arg;
+    uint64_t retaddr;
+} rec_v2;
+#pragma pack(pop)
+
+#define MEMHOOK_PROBE_N   64        /* 版本探测读取的记录数 */
+#define MEMHOOK_TID_MAX   4194304u  /* PID_MAX_LIMIT */
+
+/* 按步长 rs 解读 buf，数“结构上像一条记录”的条数：op<=3、pad==0、0<tid<=PID_MAX_LIMIT，
+   另外 ts_ns 不回退的再各加一分 */
+static inline int memhook_probe_score(const unsigned char* buf, size_t len, size_t rs, size_t tid_off){
+    int score = 0; uint64_t prev = 0;
+    for(size_t off = 0; off + rs <= len; off += rs){
+        uint64_t ts; uint32_t tid; uint16_t op, pad;
+        memcpy(&ts,  buf + off, 8);
+        memcpy(&tid, buf + off + tid_off, 4);
+        memcpy(&op,  buf + off + tid_off + 4, 2);
+        memcpy(&pad, buf + off + tid_off + 6, 2);
+        if(op <= 3 && pad == 0 && tid && tid <= MEMHOOK_TID_MAX) score++;
+        if(ts >= prev) score++;
+        prev = ts;
+    }
+    return score;
+}
+
+/* 版本探测：返回 1 表示 v2，0 表示 v1；读完把文件位置还原。
+   只有一种记录长度能整除文件大小时按长度定；两种都能整除（240 的倍数）或都不能整除时，
+   按两种步长各解读前 MEMHOOK_PROBE_N 条，取结构得分高者，平手按 v2。
+   步长错时 tid/op/pad 会依次落到 ts/wall/ptr/arg/retaddr 的不同字节上，几条之内就对不上。
+   不看 wall_ns 的取值：没有 RTC 的设备上 wall_ns 可以停在 1970 年附近。 */
+static inline int memhook_bin_is_v2(FILE* f, long sz){
+    int d2 = sz % (long)sizeof(rec_v2) == 0, d1 = sz % (long)sizeof(rec_v1) == 0;
+    if(d2 != d1) return d2;
+    unsigned char buf[MEMHOOK_PROBE_N * sizeof(rec_v2)];
+    long pos = ftell(f);
+    size_t got = fread(buf, 1, sizeof(buf), f);
+    fseek(f, pos, SEEK_SET);
+    int s2 = memhook_probe_score(buf, got, sizeof(rec_v2), offsetof(rec_v2, tid));
+    int s1 = memhook_probe_score(buf, got, sizeof(rec_v1), offsetof(rec_v1, tid));
+    return s2 >= s1;
+}
+
+/* ================= mem_sampler 日志（MWS1） ================= */
+#define MWS_MAGIC    0x3153574du    /* "MWS1" */
+#define MWS_VERSION  1
+#define MWS_TOPMAP   8
+#define MWS_TOPSLAB  4
+
+/* mws_rec.flags */
+#define MWS_F_PROC    0x01          /* 进程存在，status 字段有效 */
+#define MWS_F_ROLLUP  0x02          /* 汇总来自 smaps_rollup */
+#define MWS_F_SMAPS   0x04          /* 本次做了完整 smaps 扫描（map[] 有效：相对上一次完整扫描的 Δ） */
+#define MWS_F_SLAB    0x08          /* slabinfo 可读 */
+#define MWS_F_NEWPID  0x10          /* PID 变化（首轮 smaps 只建基线，无 Δ） */
+
+/* mws_map.flags */
+#define MWS_M_NEW     0x01          /* 上一轮不存在的映射，delta=rss */
+#define MWS_M_ANON    0x02          /* 无文件路径（[anon]/[heap]/[stack]...） */
+#define MWS_M_WRITE   0x04          /* 可写 */
+
+#pragma pack(push,1)
+typedef struct {                    /* 64B，位于 offset 0 */
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_size;
+    uint32_t slots;                 /* 环形槽位数 */
+    uint32_t pad;
+    uint64_t seq;                   /* 已写入总条数；下一槽位 = seq % slots */
+    uint64_t interval_us;
+    uint64_t start_wall_ns;
+    char     pname[24];
+} mws_hdr;
+
+typedef struct {                    /* 64B */
+    uint64_t start;
+    int32_t  delta_kb;
+    uint32_t rss_kb;
+    uint32_t size_kb;
+    uint16_t flags;                 /* MWS_M_* */
+    char     name[42];
+} mws_map;
+
+typedef struct {                    /* 32B */
+    char     name[28];
+    uint32_t objs;
+} mws_slab;
+
+typedef struct {                    /* 816B */
+    uint64_t seq;
+    uint64_t ts_ns;                 /* CLOCK_MONOTONIC */
+    uint64_t wall_ns;               /* CLOCK_REALTIME，与 memhook v2 的 wall_ns 同源 */
+    uint32_t pid;
+    uint32_t threads;
+    uint32_t flags;                 /* MWS_F_* */
+    uint32_t n_maps;                /* 本次 smaps 映射数（未扫描为 0） */
+    /* /proc/PID/status (kB) */
+    uint64_t vm_size, vm_rss, rss_anon, rss_file, rss_shmem;
+    /* smaps_rollup / smaps 汇总 (kB) */
+    uint64_t pss, priv_dirty, anonymous, swap;
+    /* /proc/meminfo (kB) */
+    uint64_t mem_total, mem_free, mem_avail, buffers, cached, sreclaim, shmem;
+    /* /proc/slabinfo */
+    uint64_t slab_kb;
+    mws_slab slab[MWS_TOPSLAB];     /* num_objs 降序 */
+    mws_map  map[MWS_TOPMAP];       /* ΔRss>0，delta 降序 */
+} mws_rec;
+#pragma pack(pop)
+
+#endif /* MEMHOOK_FORMAT_H */
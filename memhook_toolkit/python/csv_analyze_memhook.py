@@ -8,12 +8,23 @@
 - 计算按 RA 的在存峰值排行
 - 导出结束时仍在存的大块
 - 导出时间序列（可抽样）
+
+默认用 C 引擎 libmemhook_analysis（bin/libmemhook_analysis.so，经 ctypes 调用）：
+重放在 C 里完成，结果是列式数组，有 numpy 时直接映射成 ndarray（零拷贝），否则映射成 ctypes 数组。
+找不到库或指定 --pure 时退回下面的纯 Python 实现（慢约 100 倍，且整份 CSV 读进内存）。
 """
 
 import csv
+import ctypes
 import argparse
+import os
 from collections import defaultdict, namedtuple
 
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
 Row = namedtuple("Row", "idx ts_ns wall_ns wall_time tid op ptr arg ra")
 
 def parse_int(s):
@@ -55,16 +66,59 @@ def read_rows(csv_path):
                 continue
     return rows
 
-def analyze(rows, approx_mem=None):
+class SeriesSampler:
+    """在存曲线抽样，与 libmemhook_analysis 同一算法（两条路径输出逐字节一致）：
+    每 stride 行一段、取段内在存最大的行（同值取较早者）；缓冲到 2n 点时相邻两段合并、stride 翻倍；
+    结束时补上未满的段，压到 n 点以内，再补末行。n=0 保留全部。"""
+
+    def __init__(self, n):
+        self.n = max(int(n), 0)
+        self.stride = 1
+        self.inseg = 0
+        self.seg = None
+        self.last = None
+        self.pts = []
+
+    def push(self, pt):
+        self.last = pt
+        if not self.inseg or pt["cur_live_bytes"] > self.seg["cur_live_bytes"]:
+            self.seg = pt
+        self.inseg += 1
+        if self.inseg < self.stride:
+            return
+        self.inseg = 0
+        self.pts.append(self.seg)
+        if self.n and len(self.pts) >= 2 * self.n:
+            self._halve()
+            self.stride *= 2
+
+    def _halve(self):
+        p = self.pts
+        self.pts = [p[i + 1] if i + 1 < len(p) and p[i + 1]["cur_live_bytes"] > p[i]["cur_live_bytes"] else p[i]
+                    for i in range(0, len(p), 2)]
+
+    def finish(self):
+        if self.inseg:
+            self.pts.append(self.seg)
+        while self.n and len(self.pts) > self.n:
+            self._halve()
+        if self.last is not None and (not self.pts or self.pts[-1]["idx"] != self.last["idx"]):
+            self.pts.append(self.last)
+        return self.pts
+
+def analyze(rows, approx_mem=None, downsample=400):
     """
+    重放口径与 libmemhook_analysis / memhook_dump 一致（见 lib/memhook_analysis.h）：
+    malloc/calloc 入账；free 摘下该 ptr 最近的一块；realloc 的 ptr 在存即旧块（摘下），否则登记为新块；
+    同一 ptr 重复分配时各块都算在存。在存曲线取行后状态。
     返回：
       overview: dict
-      tids_peak: list[dict]  (降序)
-      sites_peak: list[dict] (降序)
-      live_end_blocks: list[dict] (按 size 降序)
-      ts_series: list[dict] (完整序列)
+      tids_peak: list[dict]  (峰值降序，同值按 tid 升序)
+      sites_peak: list[dict] (峰值降序，同值按 retaddr 升序)
+      live_end_blocks: list[dict] (size 降序，同值按 ptr、分配时刻升序)
+      ts_series: list[dict] (按 downsample 抽样后的序列)
     """
-    # live map: ptr -> (size, tid, ra, ts_ns, wall_ns, wall_time_first)
+    # live map: ptr -> [(size, tid, ra, ts_ns, wall_time), ...]，末尾是最近分配的一块
     live = {}
 
     cur_live_bytes = 0
@@ -74,72 +128,48 @@ def analyze(rows, approx_mem=None):
     peak_wall_ns = 0
     peak_wall_time = ""
 
-    # per-tid in-mem bytes & peaks
-    tid_live = defaultdict(int)
-    tid_peak = defaultdict(int)
-    tid_peak_idx = {}
-    tid_peak_tsns = {}
-    tid_peak_wtime = {}
+    # per-tid / per-site (ra): key -> [cur, peak, peak_idx, peak_ts_ns, peak_wall_time]，只在分配时建项
+    tid_stat = {}
+    ra_stat = {}
 
-    # per-site (ra) in-mem & peaks
-    ra_live = defaultdict(int)
-    ra_peak = defaultdict(int)
-    ra_peak_idx = {}
-    ra_peak_tsns = {}
-    ra_peak_wtime = {}
+    def add_stat(m, key, size, r):
+        st = m.get(key)
+        if st is None:
+            st = m[key] = [0, 0, -1, 0, ""]
+        st[0] += size
+        if st[0] > st[1]:
+            st[1:] = [st[0], r.idx, r.ts_ns, r.wall_time]
 
-    # time series
-    ts_series = []
+    def sub_stat(m, key, size):
+        st = m.get(key)
+        if st is not None:
+            st[0] = st[0] - size if st[0] >= size else 0
+
+    series = SeriesSampler(downsample)
 
     # 近似内存上限时刻
     approx_cross = None
 
     for r in rows:
-        # 记录序列
-        ts_series.append({
-            "idx": r.idx,
-            "ts_ns": r.ts_ns,
-            "wall_time": r.wall_time,
-            "cur_live_bytes": cur_live_bytes
-        })
+        popped = None
+        if r.op == "free" or r.op == "realloc":
+            stack = live.get(r.ptr)
+            if stack:
+                popped = stack.pop()
+                if not stack:
+                    del live[r.ptr]
+                size, tid, ra = popped[:3]
+                cur_live_bytes = cur_live_bytes - size if cur_live_bytes >= size else 0
+                sub_stat(tid_stat, tid, size)
+                sub_stat(ra_stat, ra, size)
+            # 否则：free 丢失，忽略
 
-        if r.op == "malloc" or r.op == "calloc":
+        if r.op == "malloc" or r.op == "calloc" or (r.op == "realloc" and popped is None):
             size = r.arg
-            if size <= 0:
-                size = 0
-            # 如果该 ptr 已存在，先扣旧值（防御日志异常）
-            if r.ptr in live:
-                old = live[r.ptr][0]
-                cur_live_bytes -= old
-                tid_live[live[r.ptr][1]] -= old
-                ra_live[live[r.ptr][2]] -= old
-            live[r.ptr] = (size, r.tid, r.ra, r.ts_ns, r.wall_ns, r.wall_time)
+            live.setdefault(r.ptr, []).append((size, r.tid, r.ra, r.ts_ns, r.wall_time))
             cur_live_bytes += size
-            tid_live[r.tid] += size
-            ra_live[r.ra] += size
-
-        elif r.op == "realloc":
-            # 视为：先 free 旧 ptr，再 alloc 新 size 到同 ptr
-            old = live.get(r.ptr)
-            if old:
-                old_size, old_tid, old_ra, *_ = old
-                cur_live_bytes -= old_size
-                tid_live[old_tid] -= old_size
-                ra_live[old_ra] -= old_size
-            new_size = r.arg if r.arg > 0 else 0
-            live[r.ptr] = (new_size, r.tid, r.ra, r.ts_ns, r.wall_ns, r.wall_time)
-            cur_live_bytes += new_size
-            tid_live[r.tid] += new_size
-            ra_live[r.ra] += new_size
-
-        elif r.op == "free":
-            old = live.pop(r.ptr, None)
-            if old:
-                old_size, old_tid, old_ra, *_ = old
-                cur_live_bytes -= old_size
-                tid_live[old_tid] -= old_size
-                ra_live[old_ra] -= old_size
-            # 否则：free 丢失，忽略
+            add_stat(tid_stat, r.tid, size, r)
+            add_stat(ra_stat, r.ra, size, r)
 
         # 刷新整体峰值
         if cur_live_bytes > peak_live_bytes:
@@ -149,23 +179,6 @@ def analyze(rows, approx_mem=None):
             peak_wall_ns = r.wall_ns
             peak_wall_time = r.wall_time
 
-        # 刷新 tid 峰值
-        if tid_live[r.tid] > tid_peak[r.tid]:
-            tid_peak[r.tid] = tid_live[r.tid]
-            tid_peak_idx[r.tid] = r.idx
-            tid_peak_tsns[r.tid] = r.ts_ns
-            tid_peak_wtime[r.tid] = r.wall_time
-
-        # 刷新 ra 峰值
-        if ra_live[r.ra] > ra_peak[r.ra]:
-            ra_peak[r.ra] = ra_live[r.ra]
-            ra_peak_idx[r.ra] = r.idx
-            ra_peak_tsns[r.ra] = r.ts_ns
-            ra_peak_wtime[r.ra] = r.wall_time
-
-        # 记录在本行处理后的序列（覆盖前面预写的占位）
-        ts_series[-1]["cur_live_bytes"] = cur_live_bytes
-
         # 近似内存上限交叉
         if approx_mem and not approx_cross and cur_live_bytes >= approx_mem:
             approx_cross = {
@@ -175,41 +188,37 @@ def analyze(rows, approx_mem=None):
                 "cur_live_bytes": cur_live_bytes
             }
 
-    # 汇总 live 末尾大块
-    live_end_blocks = []
-    for p, (size, tid, ra, ts_ns, wall_ns, wall_time) in live.items():
-        live_end_blocks.append({
-            "ptr": f"0x{p:016x}",
-            "size": size,
-            "tid": tid,
-            "ra": f"0x{ra:016x}",
-            "alloc_ts_ns": ts_ns,
-            "alloc_wall_time": wall_time
+        series.push({
+            "idx": r.idx,
+            "ts_ns": r.ts_ns,
+            "wall_time": r.wall_time,
+            "cur_live_bytes": cur_live_bytes
         })
-    live_end_blocks.sort(key=lambda x: x["size"], reverse=True)
+
+    # 汇总 live 末尾大块
+    blocks = [(p, *b) for p, stack in live.items() for b in stack]
+    blocks.sort(key=lambda b: (-b[1], b[0], b[4]))
+    live_end_blocks = [{
+        "ptr": f"0x{p:016x}",
+        "size": size,
+        "tid": tid,
+        "ra": f"0x{ra:016x}",
+        "alloc_ts_ns": ts_ns,
+        "alloc_wall_time": wall_time
+    } for p, size, tid, ra, ts_ns, wall_time in blocks]
 
     # TID/RA 排行（取峰值）
-    tids_peak = []
-    for tid, peak in tid_peak.items():
-        tids_peak.append({
-            "tid": tid,
-            "peak_live_bytes": peak,
-            "peak_idx": tid_peak_idx.get(tid, -1),
-            "peak_ts_ns": tid_peak_tsns.get(tid, 0),
-            "peak_wall_time": tid_peak_wtime.get(tid, "")
-        })
-    tids_peak.sort(key=lambda x: x["peak_live_bytes"], reverse=True)
-
-    sites_peak = []
-    for ra, peak in ra_peak.items():
-        sites_peak.append({
-            "retaddr": f"0x{ra:016x}",
-            "peak_live_bytes": peak,
-            "peak_idx": ra_peak_idx.get(ra, -1),
-            "peak_ts_ns": ra_peak_tsns.get(ra, 0),
-            "peak_wall_time": ra_peak_wtime.get(ra, "")
-        })
-    sites_peak.sort(key=lambda x: x["peak_live_bytes"], reverse=True)
+    def ranking(m, keyname, keyfmt):
+        return [{
+            keyname: keyfmt(k),
+            "peak_live_bytes": st[1],
+            "peak_idx": st[2],
+            "peak_ts_ns": st[3],
+            "peak_wall_time": st[4]
+        } for k, st in sorted(m.items(), key=lambda kv: (-kv[1][1], kv[0]))]
+
+    tids_peak = ranking(tid_stat, "tid", lambda k: k)
+    sites_peak = ranking(ra_stat, "retaddr", lambda k: f"0x{k:016x}")
 
     overview = {
         "records": len(rows),
@@ -223,7 +232,185 @@ def analyze(rows, approx_mem=None):
         "approx_cross": approx_cross
     }
 
-    return overview, tids_peak, sites_peak, live_end_blocks, ts_series
+    return overview, tids_peak, sites_peak, live_end_blocks, series.finish()
+
+# ---------------- C 引擎（libmemhook_analysis，见 lib/memhook_analysis.h） ----------------
+MHA_ABI_VERSION = 1
+MHA_WALL_LEN = 32
+_u64, _i64, _vp = ctypes.c_uint64, ctypes.c_int64, ctypes.c_void_p
+
+class _Opts(ctypes.Structure):
+    _fields_ = [("approx_mem", _u64), ("downsample", ctypes.c_uint32), ("reserved", ctypes.c_uint32)]
+
+class _Overview(ctypes.Structure):
+    _fields_ = [("records", _u64), ("peak_live_bytes", _u64), ("peak_idx", _i64),
+                ("peak_ts_ns", _u64), ("peak_wall_ns", _u64),
+                ("end_live_blocks", _u64), ("end_live_bytes", _u64),
+                ("has_cross", ctypes.c_int32), ("pad", ctypes.c_int32), ("cross_idx", _i64),
+                ("cross_ts_ns", _u64), ("cross_wall_ns", _u64), ("cross_bytes", _u64),
+                ("peak_wall_time", ctypes.c_char * MHA_WALL_LEN),
+                ("cross_wall_time", ctypes.c_char * MHA_WALL_LEN)]
+
+class _Series(ctypes.Structure):
+    _fields_ = [("n", ctypes.c_size_t), ("idx", _vp), ("ts_ns", _vp), ("wall_ns", _vp),
+                ("live_bytes", _vp), ("wall_time", _vp)]
+
+class _Peaks(ctypes.Structure):
+    _fields_ = [("n", ctypes.c_size_t), ("key", _vp), ("peak_bytes", _vp), ("peak_idx", _vp),
+                ("peak_ts_ns", _vp), ("peak_wall_ns", _vp), ("peak_wall_time", _vp)]
+
+class _Live(ctypes.Structure):
+    _fields_ = [("n", ctypes.c_size_t), ("ptr", _vp), ("size", _vp), ("ra", _vp),
+                ("alloc_ts_ns", _vp), ("alloc_wall_ns", _vp), ("tid", _vp), ("alloc_wall_time", _vp)]
+
+def load_engine(path=None):
+    """按 --lib / $MEMHOOK_ANALYSIS_LIB / ../bin/ 的顺序找库；找不到返回 None"""
+    here = os.path.dirname(os.path.abspath(__file__))
+    cands = [path, os.environ.get("MEMHOOK_ANALYSIS_LIB"),
+             os.path.join(here, "..", "bin", "libmemhook_analysis.so"), "libmemhook_analysis.so"]
+    for c in cands:
+        if not c:
+            continue
+        try:
+            lib = ctypes.CDLL(c)
+        except OSError:
+            continue
+        lib.mha_abi_version.restype = ctypes.c_uint32
+        if lib.mha_abi_version() != MHA_ABI_VERSION:
+            continue
+        lib.mha_open.restype = _vp
+        lib.mha_open.argtypes = [ctypes.POINTER(_Opts)]
+        lib.mha_close.argtypes = [_vp]
+        lib.mha_last_error.restype = ctypes.c_char_p
+        lib.mha_last_error.argtypes = [_vp]
+        for fn in (lib.mha_feed_csv, lib.mha_feed_bin):
+            fn.argtypes = [_vp, ctypes.c_char_p]
+        lib.mha_finish.argtypes = [_vp]
+        for fn, st in ((lib.mha_overview_get, _Overview), (lib.mha_series_get, _Series),
+                       (lib.mha_sites_get, _Peaks), (lib.mha_tids_get, _Peaks), (lib.mha_live_get, _Live)):
+            fn.argtypes = [_vp, ctypes.POINTER(st)]
+        return lib
+    return None
+
+def _col(addr, ctype, n):
+    """把 C 端一列映射成数组（不拷贝）；结果只在 NativeResult.close() 之前有效"""
+    if not n:
+        return []
+    arr = (ctype * n).from_address(addr)
+    return np.ctypeslib.as_array(arr) if np is not None else arr
+
+def _strcol(addr, n):
+    if not n:
+        return []
+    raw = (ctypes.c_char * (n * MHA_WALL_LEN)).from_address(addr)
+    if np is not None:
+        return np.frombuffer(raw, dtype=f"S{MHA_WALL_LEN}")
+    return (ctypes.c_char * MHA_WALL_LEN * n).from_address(addr)
+
+def wt(col, i):
+    v = col[i]
+    return (v if isinstance(v, bytes) else v.value).decode()
+
+class NativeResult:
+    """C 引擎的结果：overview 为 dict，其余为列（ndarray 或 ctypes 数组）"""
+
+    def __init__(self, lib, path, approx_mem=None, downsample=400):
+        self.lib = lib
+        opts = _Opts(int(approx_mem or 0), max(int(downsample), 0), 0)
+        self.ctx = lib.mha_open(ctypes.byref(opts))
+        if not self.ctx:
+            raise MemoryError("mha_open failed")
+        feed = lib.mha_feed_bin if path.endswith(".bin") else lib.mha_feed_csv
+        if feed(self.ctx, path.encode()) != 0 or lib.mha_finish(self.ctx) != 0:
+            err = lib.mha_last_error(self.ctx).decode()
+            self.close()
+            raise RuntimeError(err)
+
+        ov = _Overview(); lib.mha_overview_get(self.ctx, ctypes.byref(ov))
+        self.overview = {
+            "records": ov.records,
+            "peak_live_bytes": ov.peak_live_bytes,
+            "peak_idx": ov.peak_idx,
+            "peak_ts_ns": ov.peak_ts_ns,
+            "peak_wall_ns": ov.peak_wall_ns,
+            "peak_wall_time": ov.peak_wall_time.decode(),
+            "end_live_blocks": ov.end_live_blocks,
+            "end_live_bytes": ov.end_live_bytes,
+            "approx_cross": {
+                "idx": ov.cross_idx,
+                "ts_ns": ov.cross_ts_ns,
+                "wall_time": ov.cross_wall_time.decode(),
+                "cur_live_bytes": ov.cross_bytes,
+            } if ov.has_cross else None,
+        }
+
+        s = _Series(); lib.mha_series_get(self.ctx, ctypes.byref(s))
+        self.series = {
+            "idx": _col(s.idx, _i64, s.n), "ts_ns": _col(s.ts_ns, _u64, s.n),
+            "wall_ns": _col(s.wall_ns, _u64, s.n), "cur_live_bytes": _col(s.live_bytes, _u64, s.n),
+            "wall_time": _strcol(s.wall_time, s.n),
+        }
+        self.tids = self._peaks(lib.mha_tids_get)
+        self.sites = self._peaks(lib.mha_sites_get)
+
+        lv = _Live(); lib.mha_live_get(self.ctx, ctypes.byref(lv))
+        self.live = {
+            "ptr": _col(lv.ptr, _u64, lv.n), "size": _col(lv.size, _u64, lv.n), "ra": _col(lv.ra, _u64, lv.n),
+            "alloc_ts_ns": _col(lv.alloc_ts_ns, _u64, lv.n), "alloc_wall_ns": _col(lv.alloc_wall_ns, _u64, lv.n),
+            "tid": _col(lv.tid, ctypes.c_uint32, lv.n), "alloc_wall_time": _strcol(lv.alloc_wall_time, lv.n),
+        }
+
+    def _peaks(self, getter):
+        p = _Peaks(); getter(self.ctx, ctypes.byref(p))
+        return {
+            "key": _col(p.key, _u64, p.n), "peak_live_bytes": _col(p.peak_bytes, _u64, p.n),
+            "peak_idx": _col(p.peak_idx, _i64, p.n), "peak_ts_ns": _col(p.peak_ts_ns, _u64, p.n),
+            "peak_wall_ns": _col(p.peak_wall_ns, _u64, p.n), "peak_wall_time": _strcol(p.peak_wall_time, p.n),
+        }
+
+    def close(self):
+        if self.ctx:
+            self.lib.mha_close(self.ctx)
+            self.ctx = None
+
+def write_native(res, out, top):
+    """与纯 Python 路径写同样的文件；返回 (各文件路径, 行数) 供打印"""
+    def peaks_rows(pk, keyfmt):
+        for i in range(len(pk["key"]))[:top]:
+            yield [keyfmt(int(pk["key"][i])), int(pk["peak_live_bytes"][i]), int(pk["peak_idx"][i]),
+                   int(pk["peak_ts_ns"][i]), wt(pk["peak_wall_time"], i)]
+
+    paths = {}
+    paths["overview"] = os.path.join(out, "overview.csv")
+    write_csv(paths["overview"], [res.overview], [
+        "records","peak_live_bytes","peak_idx","peak_ts_ns","peak_wall_ns","peak_wall_time",
+        "end_live_blocks","end_live_bytes","approx_cross"
+    ])
+    for name, pk, keyname, keyfmt in (("top_tids_by_peak.csv", res.tids, "tid", str),
+                                      ("top_sites_by_peak.csv", res.sites, "retaddr", lambda k: f"0x{k:016x}")):
+        paths[name] = os.path.join(out, name)
+        with open(paths[name], "w", newline="") as f:
+            w = csv.writer(f)
+            w.writerow([keyname, "peak_live_bytes", "peak_idx", "peak_ts_ns", "peak_wall_time"])
+            w.writerows(peaks_rows(pk, keyfmt))
+
+    lv = res.live
+    paths["live"] = os.path.join(out, "live_blocks_at_end.csv")
+    with open(paths["live"], "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["ptr","size","tid","ra","alloc_ts_ns","alloc_wall_time"])
+        for i in range(len(lv["ptr"])):
+            w.writerow([f"0x{int(lv['ptr'][i]):016x}", int(lv["size"][i]), int(lv["tid"][i]),
+                        f"0x{int(lv['ra'][i]):016x}", int(lv["alloc_ts_ns"][i]), wt(lv["alloc_wall_time"], i)])
+
+    s = res.series
+    paths["series"] = os.path.join(out, "timeseries_downsampled.csv")
+    with open(paths["series"], "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["idx","ts_ns","wall_time","cur_live_bytes"])
+        for i in range(len(s["idx"])):
+            w.writerow([int(s["idx"][i]), int(s["ts_ns"][i]), wt(s["wall_time"], i), int(s["cur_live_bytes"][i])])
+    return paths
 
 def write_csv(path, rows, header):
     with open(path, "w", newline="") as f:
@@ -232,19 +419,6 @@ def write_csv(path, rows, header):
         for r in rows:
             w.writerow([r.get(h,"") for h in header])
 
-def downsample_series(series, n=500):
-    if n <= 0 or len(series) <= n:
-        return series
-    step = len(series) / n
-    out = []
-    i = 0.0
-    while int(i) < len(series):
-        out.append(series[int(i)])
-        i += step
-    if out[-1] is not series[-1]:
-        out.append(series[-1])
-    return out
-
 def main():
     ap = argparse.ArgumentParser()
     ap.add_argument("csv", help="memhook records.csv")
@@ -252,14 +426,37 @@ def main():
     ap.add_argument("--downsample", type=int, default=400, help="downsample points for time series")
     ap.add_argument("--top", type=int, default=50, help="top-N for rankings")
     ap.add_argument("--approx-mem", type=float, default=0.0, help="approximate memory ceiling in bytes (optional)")
+    ap.add_argument("--lib", default=None, help="path to libmemhook_analysis.so (default: ../bin/)")
+    ap.add_argument("--pure", action="store_true", help="force the pure-Python replay (no C engine)")
     args = ap.parse_args()
 
-    import os
     os.makedirs(args.out, exist_ok=True)
 
+    lib = None if args.pure else load_engine(args.lib)
+    if lib is not None:
+        res = NativeResult(lib, args.csv, approx_mem=(args.approx_mem if args.approx_mem > 0 else None),
+                           downsample=args.downsample)
+        try:
+            paths = write_native(res, args.out, args.top)
+            ov = res.overview
+            print(f"[ok] overview -> {paths['overview']}  (engine: libmemhook_analysis, numpy={'yes' if np is not None else 'no'})")
+            print(f"     peak_live_bytes={ov['peak_live_bytes']} at {ov['peak_wall_time']} (idx={ov['peak_idx']})")
+            if ov["approx_cross"]:
+                ac = ov["approx_cross"]
+                print(f"     crossed approx-mem at {ac['wall_time']} (bytes={ac['cur_live_bytes']}, idx={ac['idx']})")
+            print(f"[ok] top tids -> {paths['top_tids_by_peak.csv']} (TOP {len(res.tids['key'][:args.top])})")
+            print(f"[ok] top sites -> {paths['top_sites_by_peak.csv']} (TOP {len(res.sites['key'][:args.top])})")
+            print(f"[ok] live-at-end blocks -> {paths['live']} (n={len(res.live['ptr'])})")
+            print(f"[ok] time series (downsampled) -> {paths['series']} (points={len(res.series['idx'])}/{ov['records']})")
+        finally:
+            res.close()
+        return
+    if args.csv.endswith(".bin"):
+        raise SystemExit("[err] .bin input needs libmemhook_analysis (run make)")
+
     rows = read_rows(args.csv)
     overview, tids_peak, sites_peak, live_end_blocks, ts_series = analyze(
-        rows, approx_mem=(args.approx_mem if args.approx_mem>0 else None)
+        rows, approx_mem=(args.approx_mem if args.approx_mem>0 else None), downsample=args.downsample
     )
 
     # 概览
@@ -284,9 +481,8 @@ def main():
     write_csv(leaks_path, live_end_blocks, ["ptr","size","tid","ra","alloc_ts_ns","alloc_wall_time"])
 
     # 时间序列（抽样）
-    ds = downsample_series(ts_series, args.downsample)
     ts_path = os.path.join(args.out, "timeseries_downsampled.csv")
-    write_csv(ts_path, ds, ["idx","ts_ns","wall_time","cur_live_bytes"])
+    write_csv(ts_path, ts_series, ["idx","ts_ns","wall_time","cur_live_bytes"])
 
     # 控制台给出关键摘要
     print(f"[ok] overview -> {ov_path}")
@@ -297,7 +493,7 @@ def main():
     print(f"[ok] top tids -> {tid_path} (TOP {len(top_tids)})")
     print(f"[ok] top sites -> {site_path} (TOP {len(top_sites)})")
     print(f"[ok] live-at-end blocks -> {leaks_path} (n={len(live_end_blocks)})")
-    print(f"[ok] time series (downsampled) -> {ts_path} (points={len(ds)}/{len(ts_series)})")
+    print(f"[ok] time series (downsampled) -> {ts_path} (points={len(ts_series)}/{overview['records']})")
 
 if __name__ == "__main__":
     main()
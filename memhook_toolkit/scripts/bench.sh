@@ -0,0 +1,228 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# scripts/bench.sh
+# 用 bin/memhook_gen 生成确定性 trace，逐个跑工具，记录 records/s、峰值 RSS，并对照 <trace>.expect 检查结果。
+#
+# 示例：
+#   scripts/bench.sh 10000000 100000000 1000000000
+#   scripts/bench.sh --scenario bursty --keep 10000000
+#   make bench BENCH_SIZES="10000000" BENCH_ARGS="--scenario realloc"
+#
+# 说明：
+#   * 峰值 RSS 取自 python3 对被测进程 os.wait4() 得到的 ru_maxrss（经 sh 起成孙进程，不含 python 解释器自身；
+#     Linux 上会并入该进程已回收子进程的峰值，所以 gen_reports.sh 记的是其中最大的那个工具）；
+#     没有 python3 时退回 /usr/bin/time，都没有则只记耗时
+#   * memhook_gen 同时写一份对齐的 mem_sampler 日志，用来测 memhook_rss_fuse（--gen-arg --v1 时跳过）
+#   * 每个规模先估算磁盘占用（.bin + CSV 两份），不够就跳过该规模
+#   * 结果追加到 <dir>/results.csv
+
+# ---------- 默认参数 ----------
+BENCH_DIR="bench_out"
+SEED=1
+PY_MAX=10000000            # python --pure 只跑到这个规模（纯 Python 约 10 万行/秒）；走引擎的不受限
+PIPELINE=1                 # 也跑一遍 gen_reports.sh 全流程
+KEEP=0
+GEN_ARGS=()
+FAILED=0
+
+TOOL_GEN="bin/memhook_gen"
+TOOL_DUMP="bin/memhook_dump"
+TOOL_CSV="bin/memhook_csv_analyze"
+TOOL_FUSE="bin/memhook_rss_fuse"
+TOOL_PY="python/csv_analyze_memhook.py"
+GEN_REPORTS="scripts/gen_reports.sh"
+
+usage() {
+  cat <<EOF
+Usage: $(basename "$0") [options] <events ...>
+
+Options:
+  --dir DIR          工作/输出目录 (default: bench_out/)
+  --seed N           生成器种子 (default: 1)
+  --scenario NAME    生成器场景：steady|leaky|bursty|realloc
+  --gen-arg ARG      透传给 memhook_gen 的参数，可重复（如 --gen-arg --v1）
+  --py-max N         python --pure 的最大规模 (default: 10000000)
+  --no-pipeline      不跑 gen_reports.sh
+  --keep             保留生成的 .bin/CSV/报告
+  -h, --help         显示帮助
+EOF
+}
+
+SIZES=()
+while (($#)); do
+  case "$1" in
+    --dir)          BENCH_DIR="$2"; shift 2;;
+    --seed)         SEED="$2"; shift 2;;
+    --scenario)     GEN_ARGS+=(--scenario "$2"); shift 2;;
+    --gen-arg)      GEN_ARGS+=("$2"); shift 2;;
+    --py-max)       PY_MAX="$2"; shift 2;;
+    --no-pipeline)  PIPELINE=0; shift 1;;
+    --keep)         KEEP=1; shift 1;;
+    -h|--help)      usage; exit 0;;
+    -*) echo "Unknown option: $1" >&2; usage; exit 1;;
+    *)  SIZES+=("$1"); shift;;
+  esac
+done
+((${#SIZES[@]})) || SIZES=(10000000 100000000 1000000000)
+
+for t in "$TOOL_GEN" "$TOOL_DUMP" "$TOOL_CSV" "$TOOL_FUSE"; do
+  [[ -x "$t" ]] || { echo "Error: tool not found: $t (run make)" >&2; exit 1; }
+done
+FUSE=1
+for a in "${GEN_ARGS[@]:-}"; do [[ "$a" == --v1 ]] && FUSE=0; done   # v1 没有 wall_ns，无法与采样对齐
+PY=""; command -v python3 >/dev/null && PY=python3
+TIME_BIN=""; [[ -x /usr/bin/time ]] && TIME_BIN=/usr/bin/time
+
+mkdir -p "$BENCH_DIR"
+RESULTS="$BENCH_DIR/results.csv"
+[[ -f "$RESULTS" ]] || echo "events,tool,records,seconds,records_per_sec,max_rss_kb,check" > "$RESULTS"
+
+# ---------- 计时 + 峰值 RSS ----------
+MEASURE_PY='
+import ctypes, os, subprocess, sys, time
+# exec 会把 fork 出来的 python 的 RSS 峰值带进子进程的 ru_maxrss（约 11MB 的底）。
+# 所以让 sh 在后台起被测命令（孙进程，从很小的 sh 地址空间 fork），本进程设为 subreaper 接管它，
+# 再对它 os.wait4() 取自己的 ru_maxrss。
+ctypes.CDLL(None).prctl(36, 1, 0, 0, 0)            # PR_SET_CHILD_SUBREAPER
+r, w = os.pipe()
+with open(sys.argv[1], "wb") as log:
+    t = time.monotonic()
+    subprocess.call(["sh", "-c", "\"$@\" & echo $! >&%d" % w, "sh"] + sys.argv[2:],
+                    stdout=log, stderr=subprocess.STDOUT, pass_fds=(w,))
+    os.close(w)
+    pid = int(os.read(r, 32))
+    _, st, ru = os.wait4(pid, 0)
+    dt = time.monotonic() - t
+rc = os.WEXITSTATUS(st) if os.WIFEXITED(st) else 128 + os.WTERMSIG(st)
+print("%.3f %d %d" % (dt, ru.ru_maxrss, rc))
+'
+# 输出 "秒 峰值RSS(KB) 退出码"，命令的 stdout/stderr 写入 $1
+measure() {
+  local log="$1"; shift
+  if [[ -n "$PY" ]]; then
+    "$PY" -c "$MEASURE_PY" "$log" "$@"
+  elif [[ -n "$TIME_BIN" ]]; then
+    local rc=0
+    "$TIME_BIN" -f "%e %M" -o "$log.time" "$@" >"$log" 2>&1 || rc=$?
+    echo "$(cat "$log.time") $rc"; rm -f "$log.time"
+  else
+    local t0 t1 rc=0
+    t0=$(date +%s.%N); "$@" >"$log" 2>&1 || rc=$?; t1=$(date +%s.%N)
+    echo "$(awk -v a="$t0" -v b="$t1" 'BEGIN{printf "%.3f", b-a}') - $rc"
+  fi
+}
+
+# ---------- 对照 .expect ----------
+expect_get() { awk -F= -v k="$1" '$1==k{print $2}' "$EXPECT"; }
+
+# memhook_dump 的 summary：records、各 op 计数、在存块数（字节数是人类可读格式，不比）
+check_dump() {
+  local log="$1" got want
+  got=$(awk '
+    /^records=/          { split($1,a,"="); r=a[2] }
+    /^counts:/           { for(i=2;i<=NF;i++){ split($i,a,"="); c[a[1]]=a[2] } }
+    /^live=/             { for(i=1;i<=NF;i++) if($(i+1) ~ /^blocks/) b=$i }
+    END { printf "%s %s %s %s %s %s", r, c["malloc"], c["free"], c["realloc"], c["calloc"], b }' "$log")
+  want="$(expect_get records) $(expect_get malloc) $(expect_get free) $(expect_get realloc) $(expect_get calloc) $(expect_get end_live_blocks)"
+  [[ "$got" == "$want" ]] && echo PASS || echo "FAIL(got:$got want:$want)"
+}
+# overview.csv：records,peak_live_bytes,peak_idx,...,end_live_blocks,end_live_bytes
+check_overview() {
+  local ov="$1" got want
+  [[ -f "$ov" ]] || { echo "FAIL(no $ov)"; return; }
+  got=$(awk -F, 'NR==2{ printf "%s %s %s %s %s", $1, $2, $3, $7, $8 }' "$ov")
+  want="$(expect_get records) $(expect_get peak_live_bytes) $(expect_get peak_idx) $(expect_get end_live_blocks) $(expect_get end_live_bytes)"
+  [[ "$got" == "$want" ]] && echo PASS || echo "FAIL(got:$got want:$want)"
+}
+
+# python --pure：overview 对照 .expect，其余输出须与引擎路径逐字节相同
+check_pure() {
+  local out="$1" ref="$2" c
+  c=$(check_overview "$out/overview.csv")
+  [[ "$c" == PASS ]] || { echo "$c"; return; }
+  diff -rq "$ref" "$out" >/dev/null && echo PASS || echo "FAIL(differs from $ref)"
+}
+
+# memhook_rss_fuse 的 "[ok] samples=.. trace_events=.. flagged=.."：最后一条采样在 trace 末尾，trace_events == records
+check_fuse() {
+  local log="$1" got want
+  got=$(awk '/^\[ok\] samples=/{ for(i=2;i<=4;i++){ split($i,a,"="); v[a[1]]=a[2] } }
+    END { printf "%s %s %s", v["samples"], v["trace_events"], v["flagged"] }' "$log")
+  want="$(expect_get rss_samples) $(expect_get records) $(expect_get rss_flagged)"
+  [[ "$got" == "$want" ]] && echo PASS || echo "FAIL(got:$got want:$want)"
+}
+
+report() {   # events tool "secs rss rc" check
+  local n="$1" tool="$2" secs rss rc check="$4" recs rate
+  read -r secs rss rc <<<"$3"
+  recs=$(expect_get records)
+  [[ "$rc" == 0 ]] || check="FAIL(exit $rc)"
+  rate=$(awk -v r="$recs" -v s="$secs" 'BEGIN{ printf "%.0f", (s>0)? r/s : 0 }')
+  printf "%-12s %-28s %12s %9ss %12s rec/s %10s KB  %s\n" "$n" "$tool" "$recs" "$secs" "$rate" "$rss" "$check"
+  echo "$n,$tool,$recs,$secs,$rate,$rss,$check" >> "$RESULTS"
+  [[ "$check" == FAIL* ]] && FAILED=1
+  return 0
+}
+
+avail_bytes() { df -Pk "$BENCH_DIR" | awk 'NR==2{ printf "%.0f", $4*1024 }'; }
+
+echo "[bench] dir=$BENCH_DIR seed=$SEED gen_args='${GEN_ARGS[*]:-}' sizes='${SIZES[*]}'"
+printf "%-12s %-28s %12s %10s %18s %13s  %s\n" events tool records time throughput max_rss check
+
+for N in "${SIZES[@]}"; do
+  # .bin 48B/条 + CSV 约 120B/条；gen_reports 会再写一份 CSV
+  need=$(( N * (48 + 120 * (1 + PIPELINE)) ))
+  have=$(avail_bytes)
+  if (( need > have )); then
+    echo "[skip] $N events: needs ~$((need >> 30)) GB, $((have >> 30)) GB free in $BENCH_DIR"
+    continue
+  fi
+
+  W="$BENCH_DIR/n$N"
+  rm -rf "$W"; mkdir -p "$W"
+  BIN="$W/trace.bin"; CSV="$W/records.csv"; EXPECT="$BIN.expect"; RSS="$W/rss.bin"
+  RSS_ARGS=(); (( FUSE == 1 )) && RSS_ARGS=(--rss-log "$RSS")
+
+  r=$(measure "$W/gen.log" "$TOOL_GEN" "$BIN" --events "$N" --seed "$SEED" "${GEN_ARGS[@]}" "${RSS_ARGS[@]}")
+  [[ -f "$EXPECT" ]] || { echo "[err] generator failed, see $W/gen.log" >&2; cat "$W/gen.log" >&2; exit 1; }
+  report "$N" memhook_gen "$r" -
+
+  r=$(measure "$W/dump.log" "$TOOL_DUMP" "$BIN")
+  report "$N" memhook_dump "$r" "$(check_dump "$W/dump.log")"
+
+  r=$(measure "$W/dump_csv.log" "$TOOL_DUMP" "$BIN" --csv "$CSV")
+  report "$N" "memhook_dump --csv" "$r" "$(check_dump "$W/dump_csv.log")"
+
+  if (( FUSE == 1 )); then
+    r=$(measure "$W/rss_fuse.log" "$TOOL_FUSE" --rss "$RSS" --trace "$BIN" --out "$W/fuse")
+    report "$N" memhook_rss_fuse "$r" "$(check_fuse "$W/rss_fuse.log")"
+  fi
+
+  r=$(measure "$W/csv_analyze.log" "$TOOL_CSV" "$CSV" --out "$W/csv_analyze")
+  report "$N" memhook_csv_analyze "$r" "$(check_overview "$W/csv_analyze/overview.csv")"
+
+  if [[ -n "$PY" ]]; then
+    r=$(measure "$W/py.log" "$PY" "$TOOL_PY" "$CSV" --out "$W/py")
+    report "$N" csv_analyze_memhook.py "$r" "$(check_overview "$W/py/overview.csv")"
+    if (( N <= PY_MAX )); then
+      r=$(measure "$W/py_pure.log" "$PY" "$TOOL_PY" "$CSV" --pure --out "$W/py_pure")
+      report "$N" "csv_analyze_memhook --pure" "$r" "$(check_pure "$W/py_pure" "$W/py")"
+    fi
+  fi
+  rm -f "$CSV"
+
+  if (( PIPELINE == 1 )); then
+    r=$(measure "$W/gen_reports.log" "$GEN_REPORTS" --out "$W/reports" \
+          --tool-dump "$TOOL_DUMP" --tool-csv "$TOOL_CSV" "$BIN")
+    report "$N" gen_reports.sh "$r" "$(check_overview "$W/reports/trace.bin/analysis/overview.csv")"
+  fi
+
+  (( KEEP == 1 )) || rm -rf "$W"
+done
+
+echo "[bench] results -> $RESULTS"
+if (( FAILED == 1 )); then
+  echo "[bench] some checks FAILED" >&2
+  exit 1
+fi
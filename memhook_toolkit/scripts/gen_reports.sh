@@ -28,9 +28,11 @@ DO_PEAK=0                  # --peak 开启峰值统计
 APPROX_MEM=""              # 传给 CSV 分析器的近似上限（字节）
 CSV_TOP=100                # CSV 分析器排行 TOP
 CSV_DOWNSAMPLE=400         # CSV 分析器 time-series 抽样点数
+RSS_LOG=""                 # mem_sampler 日志；给出则与 trace 做时间线融合
 
 TOOL_DUMP="bin/memhook_dump"
 TOOL_CSV="bin/memhook_csv_analyze"
+TOOL_FUSE="bin/memhook_rss_fuse"
 
 # ---------- 帮助 ----------
 usage() {
@@ -49,8 +51,10 @@ Options:
   --approx-mem BYTES    提示 CSV 分析器“近似内存上限”，用于标注首次越阈值时刻
   --csv-top N           CSV 分析排行 TOP（默认 100）
   --csv-downsample N    CSV 抽样点数（默认 400）
+  --rss-log PATH        mem_sampler 日志，与 trace 按 wall_ns 融合（需 v2 .bin）
   --tool-dump PATH      memhook_dump 路径（默认 bin/memhook_dump）
   --tool-csv PATH       memhook_csv_analyze 路径（默认 bin/memhook_csv_analyze）
+  --tool-fuse PATH      memhook_rss_fuse 路径（默认 bin/memhook_rss_fuse）
   -h, --help            显示帮助
 
 Examples:
@@ -74,8 +78,10 @@ while (($#)); do
     --approx-mem)       APPROX_MEM="$2"; shift 2;;
     --csv-top)          CSV_TOP="${2:-100}"; shift 2;;
     --csv-downsample)   CSV_DOWNSAMPLE="${2:-400}"; shift 2;;
+    --rss-log)          RSS_LOG="$2"; shift 2;;
     --tool-dump)        TOOL_DUMP="$2"; shift 2;;
     --tool-csv)         TOOL_CSV="$2"; shift 2;;
+    --tool-fuse)        TOOL_FUSE="$2"; shift 2;;
     -h|--help)          usage; exit 0;;
     --)                 shift; break;;
     -*) echo "Unknown option: $1" >&2; usage; exit 1;;
@@ -175,6 +181,13 @@ for NAME in "${ARGS[@]}"; do
     fi
   fi
 
+  # heap 与 RSS 时间线融合（直接读 .bin，不依赖 CSV）
+  FUSE_DIR="$OUT_DIR/fuse"
+  if [[ -n "$RSS_LOG" && -x "$TOOL_FUSE" ]]; then
+    "$TOOL_FUSE" --rss "$RSS_LOG" --trace "$BIN" --out "$FUSE_DIR" >/dev/null \
+      || echo "[warn] rss fuse failed for $BIN (v1 trace without wall_ns?)" >&2
+  fi
+
   echo "[ok ] wrote:"
   printf "      - %s\n" "$SUMMARY_FILE"
   printf "      - %s\n" "$LEAKS_FILE"
@@ -182,6 +195,7 @@ for NAME in "${ARGS[@]}"; do
     printf "      - %s\n" "$CSV_FILE"
     [[ -d "$ANA_DIR" ]] && printf "      - %s/{overview.csv,top_tids_by_peak.csv,top_sites_by_peak.csv,live_blocks_at_end.csv,timeseries_downsampled.csv}\n" "$ANA_DIR"
   fi
+  [[ -d "$FUSE_DIR" ]] && printf "      - %s/{fused_timeline.csv,anon_growth_intervals.csv,mapping_rank.csv}\n" "$FUSE_DIR"
 done
 
 echo "[gen] all done."
@@ -6,29 +6,8 @@
 #include <string.h>
 #include <time.h>
 
-/* ---- record formats ---- */
-#pragma pack(push,1)
-typedef struct {                    /* v1: 40B, no wall_ns */
-    uint64_t ts_ns;
-    uint32_t tid;
-    uint16_t op;
-    uint16_t pad;
-    uint64_t ptr;
-    uint64_t arg;
-    uint64_t retaddr;
-} rec_v1;
+#include "memhook_format.h"
 
-typedef struct {                    /* v2: 48B, with wall_ns */
-    uint64_t ts_ns;
-    uint64_t wall_ns;               /* NEW in v2 */
-    uint32_t tid;
-    uint16_t op;
-    uint16_t pad;
-    uint64_t ptr;
-    uint64_t arg;
-    uint64_t retaddr;
-} rec_v2;
-#pragma pack(pop)
 
 /* ---- utils ---- */
 static const char* op_name(uint16_t op){
@@ -82,20 +61,44 @@ typedef struct Live {
     uint32_t tid;
     struct Live* next;
 } Live;
-static Live* live_head=NULL;
+/* 按 ptr 分桶的链表；块数超过桶数即翻倍，free 查找保持 O(1) */
+static Live** live_tab=NULL;
+static size_t live_nb=0, live_cnt=0;
 
+static size_t live_bucket(uint64_t ptr){
+    ptr^=ptr>>33; ptr*=0xff51afd7ed558ccdULL; ptr^=ptr>>33;
+    return (size_t)ptr & (live_nb-1);
+}
+static void live_rehash(size_t nb){
+    Live** nt=(Live**)calloc(nb,sizeof(Live*));
+    if(!nt) return;                         /* 扩不动就继续用旧表，只是链变长 */
+    Live** old=live_tab; size_t onb=live_nb;
+    live_tab=nt; live_nb=nb;
+    for(size_t i=0;i<onb;i++){
+        for(Live* p=old[i]; p; ){
+            Live* nx=p->next; size_t b=live_bucket(p->ptr);
+            p->next=live_tab[b]; live_tab[b]=p; p=nx;
+        }
+    }
+    free(old);
+}
 static void add_live(uint64_t ptr,uint64_t size,uint32_t tid,uint64_t ts,uint64_t wall,uint64_t ra){
+    if(live_cnt>=live_nb) live_rehash(live_nb? live_nb*2 : 1<<16);
+    if(!live_tab) return;
     Live* n=(Live*)malloc(sizeof(Live));
     if(!n) return;
     n->ptr=ptr; n->size=size; n->tid=tid; n->ts_ns=ts; n->wall_ns=wall; n->ra=ra;
-    n->next=live_head; live_head=n;
+    size_t b=live_bucket(ptr);
+    n->next=live_tab[b]; live_tab[b]=n; live_cnt++;
 }
 static int del_live(uint64_t ptr, uint64_t* out_size){
-    Live **pp=&live_head, *p=live_head;
+    if(!live_tab) return 0;
+    size_t b=live_bucket(ptr);
+    Live **pp=&live_tab[b], *p=live_tab[b];
     while(p){
         if(p->ptr==ptr){
             if(out_size) *out_size = p->size;
-            *pp=p->next; free(p); return 1;
+            *pp=p->next; free(p); live_cnt--; return 1;
         }
         pp=&p->next; p=p->next;
     }
@@ -179,11 +182,8 @@ int main(int argc,char**argv){
     FILE* f=fopen(opt.bin_path,"rb"); if(!f){ perror("fopen"); return 2; }
     fseek(f,0,SEEK_END); long sz=ftell(f); rewind(f);
 
-    /* 判断版本：48B(v2) 优先，否则 40B(v1)，否则尝试 v2 读失败再退 v1 */
-    int is_v2=0;
-    if (sz % (long)sizeof(rec_v2) == 0 && sz/(long)sizeof(rec_v2) > 0) is_v2=1;
-    else if (sz % (long)sizeof(rec_v1) == 0 && sz/(long)sizeof(rec_v1) > 0) is_v2=0;
-    else is_v2=1;
+    /* 判断版本：见 memhook_format.h 的 memhook_bin_is_v2（记录长度 + 前若干条的结构探测） */
+    int is_v2 = memhook_bin_is_v2(f, sz);
 
     long nrec = is_v2 ? (sz/(long)sizeof(rec_v2)) : (sz/(long)sizeof(rec_v1));
 
@@ -250,7 +250,7 @@ int main(int argc,char**argv){
     size_t cap=1024, nrows=0;
     LeakRow* rows = (LeakRow*)malloc(cap*sizeof(LeakRow));
     if(!rows) cap=nrows=0;
-    for(Live* p=live_head;p;p=p->next){
+    for(size_t bi=0; bi<live_nb; bi++) for(Live* p=live_tab[bi];p;p=p->next){
         if(p->size < ((uint64_t)opt.min_size)) continue;
         live_bytes += p->size; live_blocks++;
         if(rows){
@@ -317,7 +317,8 @@ int main(int argc,char**argv){
     }
 
     /* free list */
-    while(live_head){ Live* n=live_head; live_head=live_head->next; free(n); }
+    for(size_t bi=0; bi<live_nb; bi++) while(live_tab[bi]){ Live* n=live_tab[bi]; live_tab[bi]=n->next; free(n); }
+    free(live_tab);
     if(rows) free(rows);
     return 0;
 }
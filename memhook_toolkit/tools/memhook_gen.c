@@ -0,0 +1,403 @@
+// tools/memhook_gen.c
+// 按种子确定性地生成 memhook .bin（v1 40B / v2 48B），用于基准与回归：
+// 多线程、调用点 zipf 偏斜、可控泄漏率、realloc 链、突发峰值。
+// 同时写出 <out>.expect（key=value），记录该 trace 的真值：各 op 计数、峰值、结束时在存集合。
+//
+// realloc 按 hook 的记录方式写成两条：(old_ptr, arg=0) 释放旧块，(new_ptr, arg=new_size) 登记新块，
+// 这样 memhook_dump / memhook_csv_analyze / python 三者对在存字节与块数的结论一致。
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+
+#include "memhook_format.h"
+
+enum { OP_MALLOC=0, OP_FREE=1, OP_REALLOC=2, OP_CALLOC=3 };
+
+/* ---- 参数 ---- */
+typedef struct {
+    const char* out;
+    uint64_t events;        /* 目标记录数（含收尾释放） */
+    uint64_t seed;
+    int v1;
+    int threads;
+    int sites;
+    double zipf;            /* 调用点分布指数，越大越集中 */
+    double leak_rate;       /* 分配中永不释放的比例 */
+    double realloc_rate;    /* 非分配事件里走 realloc 链的比例 */
+    int chain_max;          /* 一条 realloc 链的最长长度 */
+    double calloc_rate;
+    uint64_t live;          /* 稳态在存块数 */
+    uint64_t burst_every;   /* 每隔多少条记录来一次突发；0 关闭 */
+    double burst_mul;       /* 突发期间在存块数目标 = live * burst_mul */
+    uint64_t burst_len;     /* 突发期间的分配条数 */
+    int drain;              /* 结尾释放全部非泄漏块，使结束在存 == 泄漏集合 */
+    uint64_t gap_ns;        /* 平均事件间隔 */
+    const char* rss_log;    /* 同时写一份对齐的 mem_sampler 日志（memhook_rss_fuse 的输入） */
+    uint64_t rss_every_ns;
+    uint64_t rss_smaps_every;
+} Opts;
+
+/* 合成 RSS 模型：RssAnon = 基线 + 在存堆 * 9/8（分配器开销）+ 每 RSS_INJECT_EVERY 条采样注入的非堆匿名增长 */
+#define RSS_BASE_KB     2048
+#define RSS_FILE_KB     8192
+#define RSS_INJECT_KB   2048
+#define RSS_INJECT_EVERY 8
+
+static void usage(const char* prog){
+    fprintf(stderr,
+        "Usage: %s OUT.bin [--events N] [--seed S] [--scenario steady|leaky|bursty|realloc]\n"
+        "          [--v1] [--threads T] [--sites K] [--zipf S] [--leak-rate R] [--realloc-rate R]\n"
+        "          [--chain N] [--calloc-rate R] [--live N] [--burst-every N] [--burst-mul X]\n"
+        "          [--burst-len N] [--gap-ns N] [--no-drain]\n"
+        "          [--rss-log PATH [--rss-every-ns N] [--rss-smaps-every K]]\n"
+        "  --events N        records to write, incl. the final drain (default 1000000)\n"
+        "  --scenario NAME   preset; later options override it\n"
+        "                    steady : defaults below\n"
+        "                    leaky  : --leak-rate 0.02\n"
+        "                    bursty : --burst-every 2000000 --burst-mul 6 --burst-len 400000\n"
+        "                    realloc: --realloc-rate 0.4 --chain 24\n"
+        "  --v1              write 40B records (no wall_ns)\n"
+        "  --live N          steady-state live blocks (default 100000)\n"
+        "  --no-drain        keep the steady-state live set at the end (default: free all non-leaked)\n"
+        "  --rss-log PATH    also write a mem_sampler log aligned to the trace (v2 only):\n"
+        "                    RssAnon follows the live heap, plus non-heap anon growth (>= %d kB)\n"
+        "                    every %d samples for memhook_rss_fuse to flag\n"
+        "  --rss-every-ns N  sample interval in trace time (default 10000000)\n"
+        "  --rss-smaps-every K  mark every K-th sample as a smaps scan with map[] (default 4)\n"
+        "Writes OUT.bin and OUT.bin.expect (records/counts/peak/end live set).\n",
+        prog, RSS_INJECT_KB, RSS_INJECT_EVERY);
+}
+
+static void opts_scenario(Opts* o, const char* name){
+    if(!strcmp(name,"leaky"))        o->leak_rate=0.02;
+    else if(!strcmp(name,"bursty")){ o->burst_every=2000000; o->burst_mul=6; o->burst_len=400000; }
+    else if(!strcmp(name,"realloc")){ o->realloc_rate=0.4; o->chain_max=24; }
+    else if(strcmp(name,"steady")){ fprintf(stderr,"unknown scenario: %s\n", name); exit(1); }
+}
+
+/* ---- 随机数：splitmix64 播种 + xoshiro256** ---- */
+static uint64_t g_rs[4];
+static uint64_t splitmix(uint64_t* x){
+    uint64_t z=(*x+=0x9e3779b97f4a7c15ULL);
+    z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL; z=(z^(z>>27))*0x94d049bb133111ebULL;
+    return z^(z>>31);
+}
+static inline uint64_t rotl(uint64_t x,int k){ return (x<<k)|(x>>(64-k)); }
+static inline uint64_t rnd(void){
+    uint64_t r=rotl(g_rs[1]*5,7)*9, t=g_rs[1]<<17;
+    g_rs[2]^=g_rs[0]; g_rs[3]^=g_rs[1]; g_rs[1]^=g_rs[2]; g_rs[0]^=g_rs[3];
+    g_rs[2]^=t; g_rs[3]=rotl(g_rs[3],45);
+    return r;
+}
+static inline double rnd01(void){ return (double)(rnd()>>11) * (1.0/9007199254740992.0); }
+static inline uint64_t rnd_below(uint64_t n){ return n ? rnd()%n : 0; }
+
+/* ---- 调用点：zipf 累积分布 + 每个点一个典型大小 ---- */
+typedef struct { uint64_t ra; uint64_t size; } Site;
+static Site* g_site; static double* g_cdf; static int g_nsite;
+
+static void sites_init(int k, double s){
+    g_nsite=k; g_site=malloc(sizeof(Site)*k); g_cdf=malloc(sizeof(double)*k);
+    double sum=0;
+    for(int i=0;i<k;i++){
+        sum += 1.0/pow((double)(i+1), s); g_cdf[i]=sum;
+        g_site[i].ra = 0x0000555555550000ULL + (uint64_t)i*0x40 + (rnd()&0x3c);
+        uint64_t r=rnd_below(100);
+        if(r<2)       g_site[i].size = 65536ULL << rnd_below(7);     /* 64KB..4MB 大块 */
+        else if(r<10) g_site[i].size = 4096ULL << rnd_below(4);      /* 页级 */
+        else          g_site[i].size = (16ULL << rnd_below(8)) * (1+rnd_below(3));
+    }
+    for(int i=0;i<k;i++) g_cdf[i]/=sum;
+}
+static int site_pick(void){
+    double u=rnd01(); int l=0, r=g_nsite-1;
+    while(l<r){ int m=(l+r)/2; if(g_cdf[m]<u) l=m+1; else r=m; }
+    return l;
+}
+static uint64_t site_size(int s){
+    uint64_t b=g_site[s].size;
+    uint64_t v=b/2 + rnd_below(b+1);       /* 0.5x..1.5x */
+    return v ? v : 1;
+}
+
+/* ---- 地址分配：按 2 的幂分级，空闲地址 LIFO 复用，保证在存指针互不重叠 ---- */
+#define NCLASS 25                           /* <= 16MB 复用；更大只 bump */
+typedef struct { uint64_t* a; size_t n, cap; } U64Vec;
+static U64Vec g_freelist[NCLASS];
+static uint64_t g_bump = 0x0000100000000000ULL;
+
+static int size_class(uint64_t sz){ int c=4; while(c<63 && (1ULL<<c)<sz) c++; return c; }
+static uint64_t addr_alloc(uint64_t sz){
+    int c=size_class(sz);
+    if(c<NCLASS && g_freelist[c].n) return g_freelist[c].a[--g_freelist[c].n];
+    uint64_t p=g_bump; g_bump += (1ULL<<c) + 16;
+    return p;
+}
+static void addr_free(uint64_t p, uint64_t sz){
+    int c=size_class(sz);
+    if(c>=NCLASS) return;
+    U64Vec* v=&g_freelist[c];
+    if(v->n==v->cap){
+        if(v->cap>=(1u<<16)) return;        /* 上限：多余的地址直接丢弃 */
+        v->cap=v->cap? v->cap*2:256; v->a=realloc(v->a,v->cap*sizeof(uint64_t));
+    }
+    v->a[v->n++]=p;
+}
+
+/* ---- 在存块（非泄漏）：数组 + swap-remove，随机挑选 O(1) ---- */
+typedef struct { uint64_t ptr, size; uint32_t site, tid; } Blk;
+typedef struct { Blk* a; size_t n, cap; } BlkVec;
+static void bv_push(BlkVec* v, Blk b){ if(v->n==v->cap){ v->cap=v->cap? v->cap*2:4096; v->a=realloc(v->a,v->cap*sizeof(Blk)); } v->a[v->n++]=b; }
+
+/* ---- 对齐的 mem_sampler 日志 ----
+ * 采样时刻落在 trace 时间轴上：第一条时间戳越过采样点的记录写出之前先写采样，
+ * 所以每条采样看到的在存堆正好是 wall_ns <= 采样时刻的全部记录（与 memhook_rss_fuse 的推进规则一致）。
+ * 不用 trace 的随机数流，带不带 --rss-log 生成的 .bin 逐字节相同。
+ * 同时按 memhook_rss_fuse 的默认阈值（--min-growth 1024 --flat-ratio 0.1）算出应被标记的区间数写入 .expect。 */
+typedef struct {
+    FILE* f;
+    uint64_t every, smaps_every, next;     /* next：下一个采样点（trace ts） */
+    uint64_t n, flagged;
+    uint64_t inject_kb, smaps_inject_kb, smaps_heap_kb;
+    uint64_t prev_anon, prev_heap;
+    uint32_t threads;
+} RssLog;
+
+static void rss_sample(RssLog* l, uint64_t ts, uint64_t wall, uint64_t heap_bytes){
+    mws_rec r; memset(&r,0,sizeof(r));
+    uint64_t heap_kb=heap_bytes>>10;
+    if(l->n && l->n % RSS_INJECT_EVERY == 0){
+        /* 注入量压过本区间的堆波动（>= 16 倍），保证该区间在默认阈值下必被标记 */
+        uint64_t swing = heap_kb>l->prev_heap ? heap_kb-l->prev_heap : l->prev_heap-heap_kb;
+        l->inject_kb += swing*16 > RSS_INJECT_KB ? swing*16 : RSS_INJECT_KB;
+    }
+    r.seq=l->n; r.ts_ns=ts; r.wall_ns=wall; r.pid=4242; r.threads=l->threads;
+    r.flags=MWS_F_PROC | (l->n ? 0 : MWS_F_NEWPID);
+    r.rss_anon = RSS_BASE_KB + heap_kb + heap_kb/8 + l->inject_kb;
+    r.rss_file = RSS_FILE_KB;
+    r.vm_rss = r.rss_anon + r.rss_file;
+    r.vm_size = r.vm_rss*4; r.anonymous=r.priv_dirty=r.rss_anon; r.pss=r.vm_rss;
+    r.mem_total=16ULL<<20; r.mem_avail=r.mem_total/2; r.mem_free=r.mem_total/4;
+    if(l->n % l->smaps_every == 0){
+        /* map[]：相对上一次 smaps 采样的 ΔRss，只列正增长，大的在前 */
+        int64_t d_inj=(int64_t)(l->inject_kb - l->smaps_inject_kb), d_heap=(int64_t)heap_kb-(int64_t)l->smaps_heap_kb;
+        mws_map mi={ 0x00007f3a00000000ULL, (int32_t)d_inj, (uint32_t)l->inject_kb, 64u<<20,     /* 固定 64GB 保留区 */
+                     MWS_M_ANON | (l->smaps_inject_kb ? 0 : MWS_M_NEW), "[anon:gen_arena]" };
+        mws_map mh={ 0x0000555555a00000ULL, (int32_t)d_heap, (uint32_t)heap_kb, 1u<<30, MWS_M_ANON, "[heap]" };
+        int k=0;
+        if(d_inj>=d_heap){ if(d_inj>0) r.map[k++]=mi; if(d_heap>0) r.map[k++]=mh; }
+        else             { if(d_heap>0) r.map[k++]=mh; if(d_inj>0) r.map[k++]=mi; }
+        r.flags |= MWS_F_SMAPS; r.n_maps=2;
+        l->smaps_inject_kb=l->inject_kb; l->smaps_heap_kb=heap_kb;
+    }
+    if(l->n){
+        int64_t d_anon=(int64_t)r.rss_anon-(int64_t)l->prev_anon, d_heap=(int64_t)heap_kb-(int64_t)l->prev_heap;
+        if(d_anon>=1024 && (double)d_heap <= 0.1*(double)d_anon) l->flagged++;
+    }
+    l->prev_anon=r.rss_anon; l->prev_heap=heap_kb;
+    if(fwrite(&r,sizeof(r),1,l->f)!=1){ perror("fwrite rss log"); exit(3); }
+    l->n++;
+}
+
+/* ---- 输出 + 真值 ---- */
+#define WBATCH 65536
+typedef struct {
+    RssLog* rss;
+    FILE* f; int v1;
+    rec_v2 buf[WBATCH]; size_t nbuf;
+    uint64_t ts, wall0;
+    uint64_t recs, cnt[4];
+    uint64_t cur, peak, peak_idx, peak_ts;
+    uint64_t live_blocks;
+    uint64_t leak_blocks, leak_bytes;
+} Out;
+
+static void out_flush(Out* o){
+    if(!o->nbuf) return;
+    if(o->v1){
+        static rec_v1 b1[WBATCH];
+        for(size_t i=0;i<o->nbuf;i++){
+            rec_v2* s=&o->buf[i];
+            b1[i]=(rec_v1){ s->ts_ns, s->tid, s->op, 0, s->ptr, s->arg, s->retaddr };
+        }
+        if(fwrite(b1,sizeof(rec_v1),o->nbuf,o->f)!=o->nbuf){ perror("fwrite"); exit(3); }
+    }else if(fwrite(o->buf,sizeof(rec_v2),o->nbuf,o->f)!=o->nbuf){ perror("fwrite"); exit(3); }
+    o->nbuf=0;
+}
+static void emit(Out* o, uint64_t gap, uint32_t tid, int op, uint64_t ptr, uint64_t arg, uint64_t ra){
+    o->ts += gap/2 + rnd_below(gap+1);
+    for(RssLog* l=o->rss; l && o->ts > l->next; l->next += l->every)
+        rss_sample(l, l->next, o->wall0+l->next, o->cur);
+    rec_v2* r=&o->buf[o->nbuf++];
+    *r=(rec_v2){ o->ts, o->wall0+o->ts, tid, (uint16_t)op, 0, ptr, arg, ra };
+    o->cnt[op]++;
+    if(op==OP_MALLOC || op==OP_CALLOC){ o->cur+=arg; o->live_blocks++; }
+    else if(op==OP_REALLOC && arg){ o->cur+=arg; o->live_blocks++; }
+    if(o->cur>o->peak){ o->peak=o->cur; o->peak_idx=o->recs; o->peak_ts=o->ts; }
+    o->recs++;
+    if(o->nbuf==WBATCH) out_flush(o);
+}
+/* 释放类记录：调用者已知旧块大小 */
+static void emit_release(Out* o, uint64_t gap, uint32_t tid, int op, uint64_t ptr, uint64_t size, uint64_t ra){
+    emit(o, gap, tid, op, ptr, 0, ra);          /* 先写记录再扣减：emit 里的采样看到的是本条之前的在存 */
+    o->cur-=size; o->live_blocks--;
+}
+
+static int parse_u64(const char* s, uint64_t* out){
+    char* end=NULL; unsigned long long v=strtoull(s,&end,10);
+    if(!*s || *end) return 0;
+    *out=(uint64_t)v; return 1;
+}
+
+int main(int argc, char** argv){
+    Opts o={ .events=1000000, .seed=1, .threads=16, .sites=2000, .zipf=1.1,
+             .leak_rate=0.001, .realloc_rate=0.05, .chain_max=8, .calloc_rate=0.1,
+             .live=100000, .burst_every=0, .burst_mul=4, .burst_len=100000, .drain=1, .gap_ns=2000,
+             .rss_every_ns=10000000, .rss_smaps_every=4 };
+    if(argc<2 || argv[1][0]=='-'){ usage(argv[0]); return 1; }
+    o.out=argv[1];
+    for(int i=2;i<argc-1;i++) if(!strcmp(argv[i],"--scenario")) opts_scenario(&o, argv[i+1]);
+    for(int i=2;i<argc;i++){
+        const char* a=argv[i]; const char* v=(i+1<argc)? argv[i+1]:NULL;
+        if(!strcmp(a,"--v1")){ o.v1=1; continue; }
+        if(!strcmp(a,"--no-drain")){ o.drain=0; continue; }
+        if(!v){ usage(argv[0]); return 1; }
+        i++;
+        if(!strcmp(a,"--scenario")) continue;
+        else if(!strcmp(a,"--events")){ if(!parse_u64(v,&o.events)){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--seed")){ if(!parse_u64(v,&o.seed)){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--threads")) o.threads=atoi(v);
+        else if(!strcmp(a,"--sites")) o.sites=atoi(v);
+        else if(!strcmp(a,"--zipf")) o.zipf=atof(v);
+        else if(!strcmp(a,"--leak-rate")) o.leak_rate=atof(v);
+        else if(!strcmp(a,"--realloc-rate")) o.realloc_rate=atof(v);
+        else if(!strcmp(a,"--chain")) o.chain_max=atoi(v);
+        else if(!strcmp(a,"--calloc-rate")) o.calloc_rate=atof(v);
+        else if(!strcmp(a,"--live")){ if(!parse_u64(v,&o.live)){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--burst-every")){ if(!parse_u64(v,&o.burst_every)){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--burst-mul")) o.burst_mul=atof(v);
+        else if(!strcmp(a,"--burst-len")){ if(!parse_u64(v,&o.burst_len)){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--gap-ns")){ if(!parse_u64(v,&o.gap_ns)){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--rss-log")) o.rss_log=v;
+        else if(!strcmp(a,"--rss-every-ns")){ if(!parse_u64(v,&o.rss_every_ns) || !o.rss_every_ns){ usage(argv[0]); return 1; } }
+        else if(!strcmp(a,"--rss-smaps-every")){ if(!parse_u64(v,&o.rss_smaps_every) || !o.rss_smaps_every){ usage(argv[0]); return 1; } }
+        else { usage(argv[0]); return 1; }
+    }
+    if(o.threads<1) o.threads=1;
+    if(o.sites<1) o.sites=1;
+    if(o.chain_max<1) o.chain_max=1;
+    if(!o.live) o.live=1;
+    if(o.rss_log && o.v1){ fprintf(stderr,"--rss-log needs v2 records (wall_ns); drop --v1\n"); return 1; }
+
+    uint64_t sm=o.seed;
+    for(int i=0;i<4;i++) g_rs[i]=splitmix(&sm);
+    sites_init(o.sites, o.zipf);
+    uint32_t* tids=malloc(sizeof(uint32_t)*o.threads);
+    for(int i=0;i<o.threads;i++) tids[i]=1000+(uint32_t)i*7+(uint32_t)rnd_below(7);
+
+    Out* out=calloc(1,sizeof(Out));
+    out->v1=o.v1; out->ts=1000000000ULL; out->wall0=1700000000000000000ULL;
+    out->f=fopen(o.out,"wb");
+    if(!out->f){ perror("fopen out"); return 2; }
+    RssLog rl={0};
+    if(o.rss_log){
+        rl.f=fopen(o.rss_log,"wb");
+        if(!rl.f){ perror("fopen rss log"); return 2; }
+        mws_hdr h={0};                          /* 占位，结束时按实际条数回填 */
+        if(fwrite(&h,sizeof(h),1,rl.f)!=1){ perror("fwrite rss log"); return 3; }
+        rl.every=o.rss_every_ns; rl.smaps_every=o.rss_smaps_every; rl.next=out->ts; rl.threads=(uint32_t)o.threads;
+        out->rss=&rl;
+    }
+
+    BlkVec live={0};
+    uint64_t burst_left=0, burst_target=0; uint32_t burst_tid=0; int burst_site=0;
+
+    /* 主循环：留出收尾释放所需的记录数；每轮最多写 2*chain_max 条 */
+    uint64_t reserve=(uint64_t)o.chain_max*2;
+    while(out->recs + (o.drain? live.n:0) + reserve < o.events){
+        if(o.burst_every && !burst_left && out->recs && out->recs % o.burst_every < reserve){
+            burst_left=o.burst_len; burst_tid=tids[rnd_below(o.threads)];
+            burst_site=(int)rnd_below(g_nsite);                 /* 突发集中在一个页级以上的调用点 */
+            for(int t=0;t<g_nsite && g_site[burst_site].size<4096;t++) burst_site=(burst_site+1)%g_nsite;
+            burst_target=(uint64_t)((double)o.live*o.burst_mul);
+        }
+        int bursting = burst_left>0 && live.n<burst_target;
+        if(burst_left) burst_left--;
+        uint32_t tid = bursting ? burst_tid : tids[rnd_below(o.threads)];
+        uint64_t gap = bursting ? o.gap_ns/10+1 : o.gap_ns;
+
+        double p_alloc = bursting ? 0.9 : (live.n < o.live ? 0.6 : 0.4);
+        if(!live.n || rnd01()<p_alloc){
+            int s = bursting ? burst_site : site_pick();
+            uint64_t sz=site_size(s), p=addr_alloc(sz);
+            int op = rnd01()<o.calloc_rate ? OP_CALLOC : OP_MALLOC;
+            emit(out, gap, tid, op, p, sz, g_site[s].ra);
+            if(rnd01()<o.leak_rate){ out->leak_blocks++; out->leak_bytes+=sz; }
+            else bv_push(&live,(Blk){p,sz,(uint32_t)s,tid});
+            continue;
+        }
+        size_t k=(size_t)rnd_below(live.n);
+        Blk* b=&live.a[k];
+        if(rnd01()<o.realloc_rate){
+            /* realloc 链：同一线程把一个块反复扩容（vector/字符串拼接式增长） */
+            int len=1+(int)rnd_below(o.chain_max);
+            for(int j=0;j<len;j++){
+                uint64_t nsz=b->size + b->size/4 + rnd_below(b->size+1);
+                if(nsz > g_site[b->site].size*8) break;             /* 长到一定程度就停，避免在存无限膨胀 */
+                uint64_t np = (size_class(nsz)==size_class(b->size)) ? b->ptr : addr_alloc(nsz);
+                emit_release(out, gap, tid, OP_REALLOC, b->ptr, b->size, g_site[b->site].ra);
+                emit(out, gap/4+1, tid, OP_REALLOC, np, nsz, g_site[b->site].ra);
+                if(np!=b->ptr) addr_free(b->ptr, b->size);
+                b->ptr=np; b->size=nsz; b->tid=tid;
+            }
+            continue;
+        }
+        emit_release(out, gap, tid, OP_FREE, b->ptr, b->size, 0);
+        addr_free(b->ptr, b->size);
+        live.a[k]=live.a[--live.n];
+    }
+    if(o.drain){
+        while(live.n){
+            size_t k=(size_t)rnd_below(live.n);
+            Blk* b=&live.a[k];
+            emit_release(out, o.gap_ns, b->tid, OP_FREE, b->ptr, b->size, 0);
+            live.a[k]=live.a[--live.n];
+        }
+    }
+    out_flush(out);
+    if(fclose(out->f)){ perror("fclose"); return 3; }
+    if(rl.f){
+        /* 收尾采样：覆盖到最后一条记录；slots = 条数，日志不回绕 */
+        if(!rl.n || out->ts > rl.next-rl.every) rss_sample(&rl, out->ts, out->wall0+out->ts, out->cur);
+        mws_hdr h={ MWS_MAGIC, MWS_VERSION, sizeof(mws_rec), (uint32_t)rl.n, 0, rl.n, o.rss_every_ns/1000,
+                    out->wall0+1000000000ULL, "memhook_gen" };
+        if(fseek(rl.f,0,SEEK_SET) || fwrite(&h,sizeof(h),1,rl.f)!=1 || fclose(rl.f)){ perror("write rss log"); return 3; }
+    }
+
+    char path[1024]; snprintf(path,sizeof(path),"%s.expect",o.out);
+    FILE* fe=fopen(path,"w"); if(!fe){ perror("fopen expect"); return 2; }
+    fprintf(fe,
+        "format=%s\nseed=%" PRIu64 "\nrecords=%" PRIu64 "\n"
+        "malloc=%" PRIu64 "\nfree=%" PRIu64 "\nrealloc=%" PRIu64 "\ncalloc=%" PRIu64 "\n"
+        "peak_live_bytes=%" PRIu64 "\npeak_idx=%" PRIu64 "\npeak_ts_ns=%" PRIu64 "\n"
+        "end_live_blocks=%" PRIu64 "\nend_live_bytes=%" PRIu64 "\n"
+        "leaked_blocks=%" PRIu64 "\nleaked_bytes=%" PRIu64 "\n",
+        o.v1?"v1":"v2", o.seed, out->recs,
+        out->cnt[OP_MALLOC], out->cnt[OP_FREE], out->cnt[OP_REALLOC], out->cnt[OP_CALLOC],
+        out->peak, out->peak_idx, out->peak_ts,
+        out->live_blocks, out->cur, out->leak_blocks, out->leak_bytes);
+    if(rl.n) fprintf(fe,"rss_samples=%" PRIu64 "\nrss_flagged=%" PRIu64 "\n", rl.n, rl.flagged);
+    fclose(fe);
+
+    fprintf(stderr,"[gen] %s: records=%" PRIu64 " peak=%" PRIu64 " end_live=%" PRIu64 " bytes in %" PRIu64 " blocks (leaked %" PRIu64 ")\n",
+        o.out, out->recs, out->peak, out->cur, out->live_blocks, out->leak_blocks);
+
+    free(live.a); free(tids); free(g_site); free(g_cdf); free(out);
+    for(int i=0;i<NCLASS;i++) free(g_freelist[i].a);
+    return 0;
+}
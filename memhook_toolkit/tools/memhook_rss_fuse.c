@@ -0,0 +1,325 @@
+// tools/memhook_rss_fuse.c
+// 按 wall_ns 归并 mem_sampler 日志 (VmRSS/RssAnon/RssFile/逐映射 ΔRss) 与 memhook 在存曲线，
+// 输出 heap 可解释 / 不可解释 RSS 序列，标记 "RssAnon 涨而 heap 平" 的区间，并排行相关映射。
+// 两路输入都按时间顺序流式读取（merge join），内存只与在存块数成正比。
+// heap 在存曲线由 libmemhook_analysis 重放（与 memhook_dump / memhook_csv_analyze 同口径）。
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "memhook_analysis.h"
+#include "memhook_format.h"
+
+
+/* ---- 工具 ---- */
+static void wallns_to_full_ms(uint64_t wall_ns, char out[32]){
+    if(!wall_ns){ strcpy(out, "-"); return; }
+    time_t sec = (time_t)(wall_ns / 1000000000ull);
+    unsigned long ms = (unsigned long)((wall_ns % 1000000000ull) / 1000000ull);
+    struct tm tmv; localtime_r(&sec, &tmv);
+    strftime(out, 32, "%Y-%m-%d %H:%M:%S", &tmv);
+    size_t len = strlen(out);
+    if (len < 31) snprintf(out + len, 32 - len, ".%03lu", ms);
+}
+static int mkdir_p(const char* dir){
+    char p[512]; snprintf(p, sizeof(p), "%s", dir);
+    for(char* q = p + 1; *q; q++){
+        if(*q != '/') continue;
+        *q = '\0';
+        if(mkdir(p, 0755) != 0 && errno != EEXIST) return -1;
+        *q = '/';
+    }
+    return (mkdir(p, 0755) != 0 && errno != EEXIST) ? -1 : 0;
+}
+/* ---- trace 读取：.bin(v2) 或 records.csv，统一成 (ts, wall_ns, tid, op, ptr, arg, ra) ---- */
+typedef struct { uint64_t ts_ns, wall_ns, ptr, arg, ra; uint32_t tid; int op; } Ev;
+
+typedef struct {
+    FILE* f;
+    int is_csv;
+    int c_wall, c_op, c_ptr, c_arg, ncol;   /* CSV 列号 */
+    int c_ts, c_tid, c_ra;                  /* 可缺省，缺则为 0 */
+    char* line; size_t len;
+} TraceIn;
+
+static int op_code(const char* s){
+    if(!strcmp(s,"malloc"))  return 0;
+    if(!strcmp(s,"free"))    return 1;
+    if(!strcmp(s,"realloc")) return 2;
+    if(!strcmp(s,"calloc"))  return 3;
+    return -1;
+}
+static uint64_t parse_hex_or_dec(const char* s){
+    while(isspace((unsigned char)*s)) s++;
+    if(!*s) return 0;
+    if (!strncasecmp(s,"0x",2)) return strtoull(s, NULL, 16);
+    return strtoull(s, NULL, 10);
+}
+/* 原地切分，最多 max 列 */
+static int split_csv(char* line, char** col, int max){
+    int n=0; char* p=line;
+    while(n<max){
+        col[n++]=p;
+        char* q=strchr(p,',');
+        if(!q) break;
+        *q='\0'; p=q+1;
+    }
+    return n;
+}
+static void chomp(char* s){ size_t n=strlen(s); while(n && (s[n-1]=='\n'||s[n-1]=='\r')) s[--n]='\0'; }
+
+static int trace_open(TraceIn* t, const char* path){
+    memset(t,0,sizeof(*t));
+    t->f=fopen(path, "rb");
+    if(!t->f){ perror("open trace"); return 0; }
+    size_t pl=strlen(path);
+    t->is_csv = pl>4 && !strcasecmp(path+pl-4, ".csv");
+    if(!t->is_csv){
+        fseek(t->f,0,SEEK_END); long sz=ftell(t->f); rewind(t->f);
+        if(!memhook_bin_is_v2(t->f,sz)){
+            fprintf(stderr,"[err] %s: v1 trace (no wall_ns), cannot be aligned with RSS samples\n", path);
+            return 0;
+        }
+        return 1;
+    }
+    if(getline(&t->line,&t->len,t->f)<=0){ fprintf(stderr,"[err] empty csv\n"); return 0; }
+    chomp(t->line);
+    char* col[64]; int n=split_csv(t->line,col,64);
+    t->c_wall=t->c_op=t->c_ptr=t->c_arg=t->c_ts=t->c_tid=t->c_ra=-1; t->ncol=n;
+    for(int i=0;i<n;i++){
+        if(!strcmp(col[i],"wall_ns")) t->c_wall=i;
+        else if(!strcmp(col[i],"op"))  t->c_op=i;
+        else if(!strcmp(col[i],"ptr")) t->c_ptr=i;
+        else if(!strcmp(col[i],"arg")) t->c_arg=i;
+        else if(!strcmp(col[i],"ts_ns")) t->c_ts=i;
+        else if(!strcmp(col[i],"tid")) t->c_tid=i;
+        else if(!strcmp(col[i],"retaddr")) t->c_ra=i;
+    }
+    if(t->c_wall<0||t->c_op<0||t->c_ptr<0||t->c_arg<0){ fprintf(stderr,"[err] csv missing wall_ns/op/ptr/arg column\n"); return 0; }
+    return 1;
+}
+static int trace_next(TraceIn* t, Ev* ev){
+    if(!t->is_csv){
+        rec_v2 r;
+        if(fread(&r,sizeof(r),1,t->f)!=1) return 0;
+        ev->ts_ns=r.ts_ns; ev->wall_ns=r.wall_ns; ev->tid=r.tid; ev->op=r.op<4? r.op:-1;
+        ev->ptr=r.ptr; ev->arg=r.arg; ev->ra=r.retaddr;
+        return 1;
+    }
+    while(getline(&t->line,&t->len,t->f)>0){
+        chomp(t->line);
+        char* col[64]; int n=split_csv(t->line,col,64);
+        if(n<t->ncol) continue;
+        ev->wall_ns=strtoull(col[t->c_wall],NULL,10);
+        ev->op=op_code(col[t->c_op]);
+        ev->ptr=parse_hex_or_dec(col[t->c_ptr]);
+        ev->arg=*col[t->c_arg]? strtoull(col[t->c_arg],NULL,10):0;
+        ev->ts_ns=t->c_ts>=0? strtoull(col[t->c_ts],NULL,10):0;
+        ev->tid=t->c_tid>=0? (uint32_t)strtoul(col[t->c_tid],NULL,10):0;
+        ev->ra=t->c_ra>=0? parse_hex_or_dec(col[t->c_ra]):0;
+        return 1;
+    }
+    return 0;
+}
+static void trace_close(TraceIn* t){ if(t->f) fclose(t->f); free(t->line); }
+
+/* ---- 映射排行 ---- */
+typedef struct {
+    char name[43];
+    uint64_t end;                   /* 匿名映射按结束地址区分（向下扩展时 start 会变）；文件映射为 0（同名合并） */
+    int anon;
+    long intervals;
+    int64_t sum_kb;
+    uint32_t max_rss_kb;
+} MapRank;
+typedef struct { MapRank* a; size_t n,cap; } MapRankVec;
+
+static MapRank* get_map(MapRankVec* v, const mws_map* m){
+    int anon = (m->flags & MWS_M_ANON)!=0;
+    uint64_t end = anon ? m->start + ((uint64_t)m->size_kb<<10) : 0;
+    for(size_t i=0;i<v->n;i++)
+        if(v->a[i].end==end && !strncmp(v->a[i].name,m->name,sizeof(m->name))) return &v->a[i];
+    if(v->n==v->cap){ v->cap=v->cap? v->cap*2:128; v->a=realloc(v->a,v->cap*sizeof(*v->a)); }
+    MapRank* r=&v->a[v->n++];
+    memset(r,0,sizeof(*r));
+    memcpy(r->name,m->name,sizeof(m->name)); r->end=end; r->anon=anon;
+    return r;
+}
+static int cmp_rank_desc(const void* A,const void* B){ const MapRank* a=A,*b=B; return (a->sum_kb<b->sum_kb)-(a->sum_kb>b->sum_kb); }
+
+/* ---- 待归因的标记区间 ----
+ * map[] 只在带 MWS_F_SMAPS 的采样里有效（--lite / --smaps-every N 时大多数采样没有），
+ * 且其 Δ 是相对上一次 smaps 扫描的。所以标记区间先挂起，等到下一条 smaps 采样，
+ * 用它的 map[]（覆盖"上一条 smaps 采样 -> 本条"整个窗口）统一归因后再写出；
+ * 窗口不完整（进程重启/日志开头/结束）时 top_mappings 留空。 */
+typedef struct { uint64_t from, to; int64_t d_anon, d_heap, unexpl; } Flagged;
+typedef struct { Flagged* a; size_t n, cap; } FlaggedVec;
+
+static void flag_push(FlaggedVec* v, const Flagged* f){
+    if(v->n==v->cap){
+        size_t nc=v->cap? v->cap*2:16;
+        Flagged* na=realloc(v->a,nc*sizeof(*na));
+        if(!na) return;
+        v->a=na; v->cap=nc;
+    }
+    v->a[v->n++]=*f;
+}
+static void flag_flush(FILE* fi, FlaggedVec* v, const mws_rec* sm, MapRankVec* rank){
+    if(!v->n) return;
+    if(sm){
+        for(int i=0;i<MWS_TOPMAP && sm->map[i].delta_kb>0;i++){
+            MapRank* m=get_map(rank,&sm->map[i]);
+            m->intervals++; m->sum_kb+=sm->map[i].delta_kb;
+            if(sm->map[i].rss_kb>m->max_rss_kb) m->max_rss_kb=sm->map[i].rss_kb;
+        }
+    }
+    for(size_t k=0;k<v->n;k++){
+        const Flagged* f=&v->a[k];
+        char w0[32], w1[32];
+        wallns_to_full_ms(f->from,w0); wallns_to_full_ms(f->to,w1);
+        fprintf(fi,"%" PRIu64 ",%" PRIu64 ",%s,%s,%" PRId64 ",%" PRId64 ",%" PRId64 ",",
+                f->from, f->to, w0, w1, f->d_anon, f->d_heap, f->unexpl);
+        /* 窗口内 ΔRss 为正的映射（优先匿名，文件映射也列出便于对照） */
+        for(int i=0;sm && i<MWS_TOPMAP && sm->map[i].delta_kb>0;i++)
+            fprintf(fi,"%s%+d:%.*s@0x%" PRIx64 "%s", i?";":"", sm->map[i].delta_kb,
+                    (int)sizeof(sm->map[i].name), sm->map[i].name, sm->map[i].start,
+                    (sm->map[i].flags & MWS_M_NEW) ? "(new)" : "");
+        fputc('\n',fi);
+    }
+    v->n=0;
+}
+
+static void usage(const char* prog){
+    fprintf(stderr,
+        "Usage: %s --rss mem_watch.bin --trace <memhook.bin|records.csv> [--out DIR]\n"
+        "          [--min-growth KB] [--flat-ratio R] [--top N]\n"
+        "  --rss LOG         mem_sampler ring log\n"
+        "  --trace FILE      memhook v2 .bin (wall_ns required) or memhook_dump CSV\n"
+        "  --out DIR         output dir (default out_fuse)\n"
+        "  --min-growth KB   RssAnon growth per interval to consider (default 1024)\n"
+        "  --flat-ratio R    heap counts as flat if d_heap <= R * d_anon (default 0.1)\n"
+        "  --top N           mapping rank size (default 50)\n",
+        prog);
+}
+
+int main(int argc, char** argv){
+    const char* rss_path=NULL; const char* trace_path=NULL; const char* outdir="out_fuse";
+    long min_growth=1024; double flat_ratio=0.1; int top=50;
+
+    for(int i=1;i<argc;i++){
+        if(!strcmp(argv[i],"--rss") && i+1<argc){ rss_path=argv[++i]; continue; }
+        if(!strcmp(argv[i],"--trace") && i+1<argc){ trace_path=argv[++i]; continue; }
+        if(!strcmp(argv[i],"--out") && i+1<argc){ outdir=argv[++i]; continue; }
+        if(!strcmp(argv[i],"--min-growth") && i+1<argc){ min_growth=atol(argv[++i]); continue; }
+        if(!strcmp(argv[i],"--flat-ratio") && i+1<argc){ flat_ratio=atof(argv[++i]); continue; }
+        if(!strcmp(argv[i],"--top") && i+1<argc){ top=atoi(argv[++i]); continue; }
+        usage(argv[0]); return 1;
+    }
+    if(!rss_path || !trace_path){ usage(argv[0]); return 1; }
+    if(mkdir_p(outdir)!=0){ perror(outdir); return 3; }
+
+    int rfd=open(rss_path,O_RDONLY);
+    if(rfd<0){ perror("open rss log"); return 2; }
+    mws_hdr h;
+    if(pread(rfd,&h,sizeof(h),0)!=(ssize_t)sizeof(h) || h.magic!=MWS_MAGIC || h.version!=MWS_VERSION ||
+       h.rec_size!=sizeof(mws_rec) || h.slots==0){
+        fprintf(stderr,"[err] %s: not a mem_sampler log (or version mismatch)\n", rss_path); close(rfd); return 2;
+    }
+    TraceIn tin;
+    if(!trace_open(&tin,trace_path)){ trace_close(&tin); close(rfd); return 2; }
+
+    char path[512];
+    snprintf(path,sizeof(path),"%s/fused_timeline.csv",outdir);
+    FILE* ft=fopen(path,"w"); if(!ft){ perror("fused_timeline.csv"); return 3; }
+    snprintf(path,sizeof(path),"%s/anon_growth_intervals.csv",outdir);
+    FILE* fi=fopen(path,"w"); if(!fi){ perror("anon_growth_intervals.csv"); fclose(ft); return 3; }
+    fprintf(ft,"seq,wall_ns,wall_time,vm_rss_kb,rss_anon_kb,rss_file_kb,heap_live_kb,heap_explained_kb,unexplained_anon_kb,unexplained_rss_kb,flagged\n");
+    fprintf(fi,"from_wall_ns,to_wall_ns,from_wall_time,to_wall_time,d_rss_anon_kb,d_heap_kb,unexplained_kb,top_mappings\n");
+
+    mha_opts mo={ .downsample=1 };          /* 只用在存字节；曲线缓冲压到最小 */
+    mha_ctx* live=mha_open(&mo);
+    if(!live){ fprintf(stderr,"[err] oom\n"); return 4; }
+    MapRankVec rank={0};
+    uint64_t n_ev=0;
+    Ev ev; int have_ev=trace_next(&tin,&ev);
+
+    uint64_t n = h.seq < h.slots ? h.seq : h.slots;
+    mws_rec r, p={0}; int have_prev=0; uint64_t prev_heap_kb=0;
+    long n_samples=0, n_flagged=0; int64_t flagged_kb=0;
+    FlaggedVec pend={0}; int have_smaps=0; uint32_t smaps_pid=0;
+
+    for(uint64_t s=h.seq-n; s<h.seq; s++){
+        off_t off=(off_t)sizeof(mws_hdr)+(off_t)(s % h.slots)*(off_t)sizeof(mws_rec);
+        if(pread(rfd,&r,sizeof(r),off)!=(ssize_t)sizeof(r)) break;
+
+        /* 推进 trace 到本采样时刻 */
+        while(have_ev && ev.wall_ns <= r.wall_ns){
+            if(mha_push(live,(int64_t)n_ev,ev.ts_ns,ev.wall_ns,ev.tid,ev.op,ev.ptr,ev.arg,ev.ra)){
+                fprintf(stderr,"[err] %s\n", mha_last_error(live)); return 4;
+            }
+            n_ev++; have_ev=trace_next(&tin,&ev);
+        }
+        if(!(r.flags & MWS_F_PROC)){ flag_flush(fi,&pend,NULL,&rank); have_prev=have_smaps=0; continue; }
+        if((r.flags & MWS_F_NEWPID) || (have_prev && r.pid!=p.pid)){ flag_flush(fi,&pend,NULL,&rank); have_smaps=0; }
+
+        uint64_t heap_kb = mha_live_bytes(live)>>10;
+        uint64_t expl = heap_kb < r.rss_anon ? heap_kb : r.rss_anon;
+        int flagged = 0;
+
+        if(have_prev && !(r.flags & MWS_F_NEWPID) && r.pid==p.pid){
+            int64_t d_anon = (int64_t)r.rss_anon - (int64_t)p.rss_anon;
+            int64_t d_heap = (int64_t)heap_kb - (int64_t)prev_heap_kb;
+            if(d_anon >= min_growth && (double)d_heap <= flat_ratio*(double)d_anon){
+                int64_t unexpl = d_anon - (d_heap>0 ? d_heap : 0);
+                Flagged f={ p.wall_ns, r.wall_ns, d_anon, d_heap, unexpl };
+                flag_push(&pend,&f);
+                flagged=1; n_flagged++; flagged_kb+=unexpl;
+            }
+        }
+        if(r.flags & MWS_F_SMAPS){
+            /* 上一条 smaps 采样属于同一进程时，本条 map[] 覆盖整个窗口 */
+            flag_flush(fi,&pend, (have_smaps && smaps_pid==r.pid && !(r.flags & MWS_F_NEWPID)) ? &r : NULL, &rank);
+            have_smaps=1; smaps_pid=r.pid;
+        }
+
+        char wt[32]; wallns_to_full_ms(r.wall_ns,wt);
+        fprintf(ft,"%" PRIu64 ",%" PRIu64 ",%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%d\n",
+                r.seq, r.wall_ns, wt, r.vm_rss, r.rss_anon, r.rss_file, heap_kb, expl, r.rss_anon-expl,
+                (int64_t)r.vm_rss-(int64_t)heap_kb, flagged);
+
+        p=r; prev_heap_kb=heap_kb; have_prev=1; n_samples++;
+    }
+    flag_flush(fi,&pend,NULL,&rank);
+    fclose(ft); fclose(fi); close(rfd);
+    trace_close(&tin);
+
+    snprintf(path,sizeof(path),"%s/mapping_rank.csv",outdir);
+    FILE* fr=fopen(path,"w");
+    if(fr){
+        fprintf(fr,"mapping,end,anon,flagged_intervals,sum_delta_kb,max_rss_kb\n");
+        if(rank.n) qsort(rank.a,rank.n,sizeof(*rank.a),cmp_rank_desc);
+        for(size_t i=0;i<rank.n && (top<=0 || (int)i<top);i++)
+            fprintf(fr,"%s,0x%016" PRIx64 ",%d,%ld,%" PRId64 ",%u\n", rank.a[i].name, rank.a[i].end,
+                    rank.a[i].anon, rank.a[i].intervals, rank.a[i].sum_kb, rank.a[i].max_rss_kb);
+        fclose(fr);
+    }else perror("mapping_rank.csv");
+
+    printf("[ok] samples=%ld trace_events=%" PRIu64 " flagged=%ld (unexplained anon growth %" PRId64 " kB)\n",
+           n_samples, n_ev, n_flagged, flagged_kb);
+    if(rank.n) printf("[ok] top mapping: %s (+%" PRId64 " kB over %ld intervals)\n", rank.a[0].name, rank.a[0].sum_kb, rank.a[0].intervals);
+    printf("[ok] outputs at: %s\n", outdir);
+
+    mha_close(live); free(rank.a); free(pend.a);
+    return 0;
+}